@@ -0,0 +1,112 @@
+/**
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Replaces the global allocation functions to count every heap allocation
+// per thread, see allocations.hpp. Only linked into programs that want the
+// counts: c8-throughput always, c8 and c8-headless with C8_TRACK_ALLOCATIONS.
+
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+
+#include "allocations.hpp"
+
+namespace
+{
+    void* allocate(std::size_t size)
+    {
+        c8::allocations::recordAllocation(size);
+
+        if (void* pointer = std::malloc(size == 0 ? 1 : size)) {
+            return pointer;
+        }
+
+        throw std::bad_alloc{};
+    }
+
+    void* allocateAligned(std::size_t size, std::align_val_t alignment)
+    {
+        c8::allocations::recordAllocation(size);
+
+        const auto align = static_cast<std::size_t>(alignment);
+        const std::size_t rounded = (std::max<std::size_t>(size, 1) + align - 1) / align * align;
+
+        if (void* pointer = std::aligned_alloc(align, rounded)) {
+            return pointer;
+        }
+
+        throw std::bad_alloc{};
+    }
+}
+
+void* operator new(std::size_t size)
+{
+    return allocate(size);
+}
+
+void* operator new[](std::size_t size)
+{
+    return allocate(size);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    return allocateAligned(size, alignment);
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+    return allocateAligned(size, alignment);
+}
+
+void operator delete(void* pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer, std::size_t) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, std::align_val_t) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer, std::align_val_t) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t, std::align_val_t) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer, std::size_t, std::align_val_t) noexcept
+{
+    std::free(pointer);
+}
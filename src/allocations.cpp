@@ -0,0 +1,42 @@
+/**
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "allocations.hpp"
+
+namespace c8::allocations
+{
+    namespace
+    {
+        // Constant initialized, so reaching it from operator new never
+        // allocates itself
+        thread_local Counts threadCounts;
+    }
+
+    Counts Counts::operator-(const Counts& other) const
+    {
+        return {allocations - other.allocations, bytes - other.bytes};
+    }
+
+    Counts getThreadCounts()
+    {
+        return threadCounts;
+    }
+
+    void recordAllocation(const std::size_t bytes)
+    {
+        threadCounts.allocations++;
+        threadCounts.bytes += bytes;
+    }
+}
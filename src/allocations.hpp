@@ -0,0 +1,49 @@
+/**
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace c8::allocations
+{
+    // Set by the C8_TRACK_ALLOCATIONS build option, which links
+    // allocation_hooks.cpp into c8 and c8-headless
+#if defined(C8_TRACK_ALLOCATIONS)
+    inline constexpr bool tracking = true;
+#else
+    inline constexpr bool tracking = false;
+#endif
+
+    struct Counts
+    {
+        std::uint64_t allocations = 0;
+        std::uint64_t bytes = 0;
+
+        Counts operator-(const Counts& other) const;
+    };
+
+    /**
+     * Heap allocations made by the calling thread since it started. Always
+     * 0 unless allocation_hooks.cpp is linked into the program.
+    */
+    Counts getThreadCounts();
+
+    /**
+     * Called by the replaced global operator new
+    */
+    void recordAllocation(const std::size_t bytes);
+}
@@ -0,0 +1,112 @@
+/**
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "arena.hpp"
+
+#include <new>
+
+namespace c8::arena
+{
+    std::size_t Arena::getRequiredSize(const std::size_t machineCount, const bool includeRegisters)
+    {
+        const std::size_t frameBufferSize = machineCount * sizeof(c8::vga::VgaState);
+        const std::size_t registerSize = includeRegisters ? machineCount * sizeof(RegisterSlot) : 0;
+
+        return frameBufferSize + registerSize;
+    }
+
+    Arena::Arena(void* memory, const std::size_t size, const std::size_t machineCount, const bool includeRegisters)
+    {
+        const bool isAligned = reinterpret_cast<std::uintptr_t>(memory) % cacheLineSize == 0;
+
+        if (memory == nullptr || !isAligned || size < getRequiredSize(machineCount, includeRegisters)) {
+            return;
+        }
+
+        auto* bytes = static_cast<std::byte*>(memory);
+
+        frameBuffers = reinterpret_cast<c8::vga::VgaState*>(bytes);
+
+        for (std::size_t i = 0; i < machineCount; i++) {
+            new (frameBuffers + i) c8::vga::VgaState{};
+        }
+
+        if (includeRegisters) {
+            registers = reinterpret_cast<RegisterSlot*>(bytes + machineCount * sizeof(c8::vga::VgaState));
+
+            for (std::size_t i = 0; i < machineCount; i++) {
+                new (registers + i) RegisterSlot{};
+            }
+        }
+
+        this->machineCount = machineCount;
+    }
+
+    bool Arena::isValid() const
+    {
+        return frameBuffers != nullptr;
+    }
+
+    bool Arena::attach(std::span<c8::Machine* const> machines)
+    {
+        if (!isValid() || machines.size() != machineCount) {
+            return false;
+        }
+
+        for (std::size_t i = 0; i < machineCount; i++) {
+            machines[i]->attachVgaState(frameBuffers + i);
+
+            if (registers != nullptr) {
+                machines[i]->attachCpuState(&registers[i].cpuState);
+            }
+        }
+
+        return true;
+    }
+
+    bool Arena::detach(std::span<c8::Machine* const> machines)
+    {
+        if (!isValid() || machines.size() != machineCount) {
+            return false;
+        }
+
+        for (std::size_t i = 0; i < machineCount; i++) {
+            machines[i]->attachVgaState(nullptr);
+            machines[i]->attachCpuState(nullptr);
+        }
+
+        return true;
+    }
+
+    std::size_t Arena::getMachineCount() const
+    {
+        return machineCount;
+    }
+
+    const std::uint64_t* Arena::getRows() const
+    {
+        return frameBuffers != nullptr ? frameBuffers->getRows() : nullptr;
+    }
+
+    c8::vga::VgaState* Arena::getFrameBuffer(const std::size_t index)
+    {
+        return index < machineCount ? frameBuffers + index : nullptr;
+    }
+
+    c8::cpu::CpuState* Arena::getRegisters(const std::size_t index)
+    {
+        return registers != nullptr && index < machineCount ? &registers[index].cpuState : nullptr;
+    }
+}
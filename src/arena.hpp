@@ -0,0 +1,103 @@
+/**
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#include "cpu.hpp"
+#include "vga.hpp"
+#include "machine.hpp"
+
+namespace c8::arena
+{
+    inline constexpr std::size_t cacheLineSize = 64;
+
+    /**
+     * A machine's registers, padded to a cache line of their own
+    */
+    struct alignas(cacheLineSize) RegisterSlot
+    {
+        c8::cpu::CpuState cpuState;
+    };
+
+    // Frame buffers are plain rows, so consecutive ones form one array
+    static_assert(sizeof(c8::vga::VgaState) == c8::vga::frameBufferHeight * sizeof(std::uint64_t));
+    static_assert(sizeof(c8::vga::VgaState) % cacheLineSize == 0);
+
+    /**
+     * Lays out the frame buffers, and optionally the registers, of a number
+     * of machines in one block of memory owned by the caller:
+     *
+     *   frame buffers   machineCount x 32 rows of 64 bits
+     *   registers       machineCount x RegisterSlot, if requested
+     *
+     * The frame buffers form a [machineCount][32] array of uint64_t that can
+     * be handed to a training pipeline as a batch without gathering.
+    */
+    class Arena
+    {
+    private:
+        c8::vga::VgaState* frameBuffers = nullptr;
+        RegisterSlot* registers = nullptr;
+
+        std::size_t machineCount = 0;
+
+    public:
+        /**
+         * Bytes of memory needed for machineCount machines
+        */
+        static std::size_t getRequiredSize(const std::size_t machineCount, const bool includeRegisters);
+
+        /**
+         * memory must be aligned to cacheLineSize and hold at least
+         * getRequiredSize bytes, otherwise the arena stays invalid
+        */
+        Arena(void* memory, const std::size_t size, const std::size_t machineCount, const bool includeRegisters);
+
+        bool isValid() const;
+
+        /**
+         * Moves the frame buffer, and registers if the arena has them, of
+         * machine i into slot i. Returns false, and attaches nothing, if the
+         * arena is invalid or machines does not hold exactly machineCount
+         * machines.
+        */
+        bool attach(std::span<c8::Machine* const> machines);
+
+        /**
+         * Moves the state of every machine back into the machine, do this
+         * before the memory of the arena is freed. Returns false, and
+         * detaches nothing, under the same conditions as attach.
+        */
+        bool detach(std::span<c8::Machine* const> machines);
+
+        std::size_t getMachineCount() const;
+
+        /**
+         * machineCount * frameBufferHeight rows, machine after machine
+        */
+        const std::uint64_t* getRows() const;
+
+        c8::vga::VgaState* getFrameBuffer(const std::size_t index);
+
+        /**
+         * nullptr if the arena was made without registers
+        */
+        c8::cpu::CpuState* getRegisters(const std::size_t index);
+    };
+}
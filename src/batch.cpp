@@ -0,0 +1,355 @@
+/**
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "batch.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "config.hpp"
+#include "headless.hpp"
+#include "machine.hpp"
+#include "format.hpp"
+#include "scheduler.hpp"
+
+namespace c8::batch
+{
+    constexpr std::string_view inputExtension = ".input";
+
+    // Every machine gets the same seed so that runs are reproducible
+    constexpr std::uint32_t defaultSeed = 1;
+
+    // Frames run per scheduler step while no input is due, one emulated
+    // second, so a step is long next to waking the workers
+    constexpr std::uint64_t maxFramesPerStep = c8::config::targetHostFps;
+
+    struct Options
+    {
+        std::filesystem::path romDirectory;
+        std::filesystem::path outputPath;
+
+        c8::headless::Limits limits;
+
+        unsigned int jobs = 0;
+        std::uint32_t seed = defaultSeed;
+    };
+
+    struct Job
+    {
+        std::filesystem::path romPath;
+        std::filesystem::path inputPath;
+    };
+
+    struct JobResult
+    {
+        bool loaded = false;
+
+        std::uint64_t cycles = 0;
+        std::uint64_t frameHash = 0;
+        std::uint64_t invalidOpcodeCount = 0;
+        std::uint16_t firstInvalidOpcodeAddress = 0;
+
+        std::chrono::duration<double> wallTime{};
+    };
+
+    /**
+     * A loaded ROM with its input script and how far into it the run is
+    */
+    struct LoadedJob
+    {
+        std::size_t index;
+
+        std::vector<c8::headless::InputEvent> events;
+        std::size_t nextEvent = 0;
+    };
+
+    bool parseArgs(int argc, char** argv, Options& options)
+    {
+        std::vector<std::string> args;
+
+        args.assign(argv + 1, argv + argc);
+
+        for (std::size_t i = 0; i < args.size(); i++) {
+            const std::string& arg = args[i];
+
+            if (arg == "--jobs" && i + 1 < args.size()) {
+                options.jobs = static_cast<unsigned int>(std::stoul(args[++i]));
+                continue;
+            }
+
+            if (arg == "--cycles" && i + 1 < args.size()) {
+                options.limits.cycles = std::stoull(args[++i]);
+                continue;
+            }
+
+            if (arg == "--frames" && i + 1 < args.size()) {
+                options.limits.frames = std::stoull(args[++i]);
+                continue;
+            }
+
+            if (arg == "--seed" && i + 1 < args.size()) {
+                options.seed = static_cast<std::uint32_t>(std::stoul(args[++i]));
+                continue;
+            }
+
+            if (arg == "--output" && i + 1 < args.size()) {
+                options.outputPath = args[++i];
+                continue;
+            }
+
+            options.romDirectory = arg;
+        }
+
+        if (options.limits.cycles == 0 && options.limits.frames == 0) {
+            options.limits.frames = c8::headless::defaultFrames;
+        }
+
+        if (options.jobs == 0) {
+            options.jobs = std::max(1u, std::thread::hardware_concurrency());
+        }
+
+        return !options.romDirectory.empty();
+    }
+
+    std::vector<Job> findJobs(const std::filesystem::path& directory)
+    {
+        std::vector<Job> jobs;
+
+        for (const auto& entry : std::filesystem::directory_iterator{directory}) {
+            const std::filesystem::path& path = entry.path();
+
+            if (!entry.is_regular_file() || path.extension() == inputExtension) {
+                continue;
+            }
+
+            std::filesystem::path inputPath = path;
+
+            inputPath.replace_extension(inputExtension);
+
+            if (!std::filesystem::exists(inputPath)) {
+                inputPath.clear();
+            }
+
+            jobs.push_back({path, inputPath});
+        }
+
+        std::sort(jobs.begin(), jobs.end(), [](const Job& a, const Job& b) {
+            return a.romPath < b.romPath;
+        });
+
+        return jobs;
+    }
+
+    bool loadJob(const Job& job, c8::Machine& machine, std::vector<c8::headless::InputEvent>& events)
+    {
+        std::ifstream rom{job.romPath, std::ios::binary};
+
+        if (!rom.is_open()) {
+            return false;
+        }
+
+        if (!job.inputPath.empty() && !c8::headless::loadInputScript(job.inputPath.string(), events)) {
+            return false;
+        }
+
+        machine.loadProgram(rom);
+
+        return true;
+    }
+
+    /**
+     * Loads every job into its own machine and runs them all together on a
+     * work-stealing scheduler, frame by frame like c8::headless::runMachine.
+     * Between input events, up to maxFramesPerStep frames go into one step.
+    */
+    c8::scheduler::Stats runJobs(const std::vector<Job>& jobs, const Options& options, std::vector<JobResult>& results)
+    {
+        const c8::headless::Limits& limits = options.limits;
+
+        // Nothing is rewound, so no history is kept
+        std::deque<c8::Machine> machines;
+        std::vector<LoadedJob> loadedJobs;
+
+        for (std::size_t i = 0; i < jobs.size(); i++) {
+            c8::Machine& machine = machines.emplace_back(0, options.seed);
+            LoadedJob loadedJob{i, {}};
+
+            if (!loadJob(jobs[i], machine, loadedJob.events)) {
+                machines.pop_back();
+                continue;
+            }
+
+            loadedJobs.push_back(std::move(loadedJob));
+        }
+
+        std::vector<c8::Machine*> stepMachines;
+
+        for (c8::Machine& machine : machines) {
+            stepMachines.push_back(&machine);
+        }
+
+        // Each machine's own share of the run, summed over its slices
+        std::vector<std::chrono::duration<double>> machineTimes(stepMachines.size());
+
+        c8::scheduler::Scheduler scheduler{options.jobs};
+
+        std::uint64_t cycles = 0;
+        std::uint64_t cycleRemainder = 0;
+        std::uint64_t frames = 0;
+
+        while (true) {
+            if (limits.frames > 0 && frames >= limits.frames) {
+                break;
+            }
+
+            if (limits.cycles > 0 && cycles >= limits.cycles) {
+                break;
+            }
+
+            std::uint64_t stepEnd = frames + maxFramesPerStep;
+
+            if (limits.frames > 0) {
+                stepEnd = std::min(stepEnd, limits.frames);
+            }
+
+            for (std::size_t i = 0; i < loadedJobs.size(); i++) {
+                LoadedJob& loadedJob = loadedJobs[i];
+
+                while (loadedJob.nextEvent < loadedJob.events.size() && loadedJob.events[loadedJob.nextEvent].frame <= frames) {
+                    machines[i].processCommand(loadedJob.events[loadedJob.nextEvent].command);
+                    loadedJob.nextEvent++;
+                }
+
+                if (loadedJob.nextEvent < loadedJob.events.size()) {
+                    stepEnd = std::min(stepEnd, loadedJob.events[loadedJob.nextEvent].frame);
+                }
+            }
+
+            cycleRemainder += (stepEnd - frames) * c8::config::targetCpuFrequency;
+
+            std::uint64_t cyclesThisStep = cycleRemainder / c8::config::targetHostFps;
+
+            cycleRemainder %= c8::config::targetHostFps;
+
+            if (limits.cycles > 0) {
+                cyclesThisStep = std::min(cyclesThisStep, limits.cycles - cycles);
+            }
+
+            scheduler.step(stepMachines, cyclesThisStep, machineTimes);
+
+            cycles += cyclesThisStep;
+            frames = stepEnd;
+        }
+
+        for (std::size_t i = 0; i < loadedJobs.size(); i++) {
+            const c8::Machine& machine = machines[i];
+            JobResult& result = results[loadedJobs[i].index];
+
+            result.loaded = true;
+            result.cycles = machine.getTotalCpuCycles();
+            result.frameHash = machine.getVgaState().hash();
+            result.invalidOpcodeCount = machine.getInvalidOpcodeCount();
+            result.firstInvalidOpcodeAddress = machine.getFirstInvalidOpcodeAddress();
+            result.wallTime = machineTimes[i];
+        }
+
+        return scheduler.getStats();
+    }
+
+    void writeResults(std::ostream& out, const std::vector<Job>& jobs, const std::vector<JobResult>& results)
+    {
+        c8::format::Line line;
+
+        out << "rom\tcycles\tframe hash\tinvalid opcode\twall time (ms)\n";
+
+        for (std::size_t i = 0; i < jobs.size(); i++) {
+            const JobResult& result = results[i];
+
+            out << jobs[i].romPath.filename().string() << '\t';
+
+            if (!result.loaded) {
+                out << "-\t-\tload failed\t-\n";
+                continue;
+            }
+
+            line.clear().appendDec(static_cast<long long>(result.cycles)).append('\t')
+                .append("0x").appendHexDigits(result.frameHash, 16).append('\t');
+
+            if (result.invalidOpcodeCount > 0) {
+                line.appendHex(result.firstInvalidOpcodeAddress, false);
+            } else {
+                line.append('-');
+            }
+
+            out << line.view() << '\t' << result.wallTime.count() * 1000 << '\n';
+        }
+    }
+
+    int run(int argc, char** argv)
+    {
+        using clock = std::chrono::steady_clock;
+
+        Options options;
+
+        if (!parseArgs(argc, argv, options)) {
+            std::cerr << "Usage: " << argv[0] << " [--jobs N] [--cycles N | --frames N] [--seed N] [--output file] dir\n";
+            return 1;
+        }
+
+        if (!std::filesystem::is_directory(options.romDirectory)) {
+            std::cerr << "Not a directory: " << options.romDirectory.string() << "\n";
+            return 1;
+        }
+
+        const std::vector<Job> jobs = findJobs(options.romDirectory);
+        std::vector<JobResult> results(jobs.size());
+
+        const auto start = clock::now();
+
+        const c8::scheduler::Stats stats = runJobs(jobs, options, results);
+
+        const std::chrono::duration<double> wallTime = clock::now() - start;
+
+        if (options.outputPath.empty()) {
+            writeResults(std::cout, jobs, results);
+        } else {
+            std::ofstream out{options.outputPath};
+
+            if (!out.is_open()) {
+                std::cerr << "Could not open " << options.outputPath.string() << "\n";
+                return 1;
+            }
+
+            writeResults(out, jobs, results);
+        }
+
+        std::cerr << jobs.size() << " roms on " << options.jobs << " threads in " << wallTime.count() << "s\n";
+        std::cerr << stats.slices << " slices, " << stats.steals << " stolen tasks, "
+            << stats.getCyclesPerSecond() / 1e6 << " million cycles per second\n";
+
+        const bool allLoaded = std::all_of(results.begin(), results.end(), [](const JobResult& result) {
+            return result.loaded;
+        });
+
+        return allLoaded ? 0 : 1;
+    }
+}
@@ -0,0 +1,31 @@
+/**
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+namespace c8::batch
+{
+    /**
+     * Runs every ROM in a directory in its own headless machine, all of
+     * them stepped together by a c8::scheduler::Scheduler, and writes one
+     * tab separated line of results per ROM. Returns the process exit code.
+     *
+     * Usage: [--jobs N] [--cycles N | --frames N] [--seed N] [--output file] dir
+     *
+     * A file next to a ROM with the same name and the extension .input is
+     * used as its input script, see c8::headless::loadInputScript.
+    */
+    int run(int argc, char** argv);
+}
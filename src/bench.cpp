@@ -0,0 +1,509 @@
+/**
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "bench.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string_view>
+
+#include "cpu.hpp"
+#include "machine.hpp"
+#include "opcodes.hpp"
+#include "trace.hpp"
+#include "vga.hpp"
+
+namespace c8::bench
+{
+    Suite::Suite(const Options& options) :
+        options(options)
+    {
+    }
+
+    void Suite::run(const std::string& name, const std::function<void(std::uint64_t)>& body)
+    {
+        using clock = std::chrono::steady_clock;
+
+        if (name.find(options.filter) == std::string::npos) {
+            return;
+        }
+
+        // Grow the iteration count until one sample takes minSampleTime,
+        // jumping straight to the estimate once a sample is long enough
+        // to time
+        std::uint64_t iterations = 1;
+
+        while (true) {
+            const auto start = clock::now();
+
+            body(iterations);
+
+            const auto elapsed = clock::now() - start;
+
+            if (elapsed >= options.minSampleTime) {
+                break;
+            }
+
+            if (elapsed < options.minSampleTime / 100) {
+                iterations *= 10;
+                continue;
+            }
+
+            const double scale = 1.2 * options.minSampleTime.count() / std::chrono::nanoseconds{elapsed}.count();
+
+            iterations = std::max(iterations + 1, static_cast<std::uint64_t>(iterations * scale));
+        }
+
+        std::vector<double> samples;
+
+        for (int i = 0; i < options.repetitions; i++) {
+            const auto start = clock::now();
+
+            body(iterations);
+
+            const std::chrono::duration<double, std::nano> elapsed = clock::now() - start;
+
+            samples.push_back(elapsed.count() / iterations);
+        }
+
+        std::sort(samples.begin(), samples.end());
+
+        Result& result = results.emplace_back();
+
+        result.name = name;
+        result.iterations = iterations;
+        result.repetitions = options.repetitions;
+
+        if (samples.empty()) {
+            return;
+        }
+
+        const std::size_t middle = samples.size() / 2;
+
+        result.minNs = samples.front();
+        result.medianNs = samples.size() % 2 == 1 ? samples[middle] : (samples[middle - 1] + samples[middle]) / 2;
+
+        double sum = 0;
+
+        for (const double sample : samples) {
+            sum += sample;
+        }
+
+        result.meanNs = sum / samples.size();
+
+        double squares = 0;
+
+        for (const double sample : samples) {
+            squares += (sample - result.meanNs) * (sample - result.meanNs);
+        }
+
+        result.stddevNs = samples.size() > 1 ? std::sqrt(squares / (samples.size() - 1)) : 0;
+    }
+
+    const std::vector<Result>& Suite::getResults() const
+    {
+        return results;
+    }
+
+    void Suite::writeText(std::ostream& out) const
+    {
+        std::size_t nameWidth = 9;
+
+        for (const Result& result : results) {
+            nameWidth = std::max(nameWidth, result.name.size());
+        }
+
+        out << std::left << std::setw(nameWidth) << "benchmark" << std::right
+            << std::setw(12) << "median ns"
+            << std::setw(12) << "min ns"
+            << std::setw(12) << "stddev ns"
+            << std::setw(14) << "iterations" << "\n";
+
+        out << std::fixed << std::setprecision(2);
+
+        for (const Result& result : results) {
+            out << std::left << std::setw(nameWidth) << result.name << std::right
+                << std::setw(12) << result.medianNs
+                << std::setw(12) << result.minNs
+                << std::setw(12) << result.stddevNs
+                << std::setw(14) << result.iterations << "\n";
+        }
+
+        out << std::defaultfloat;
+    }
+
+    void writeJsonString(std::ostream& out, std::string_view text)
+    {
+        out << '"';
+
+        for (const char c : text) {
+            if (c == '"' || c == '\\') {
+                out << '\\';
+            }
+
+            out << c;
+        }
+
+        out << '"';
+    }
+
+    void Suite::writeJson(std::ostream& out) const
+    {
+        out << "{\n";
+        out << "  \"context\": {\n";
+        out << "    \"repetitions\": " << options.repetitions << ",\n";
+        out << "    \"min_sample_time_ns\": " << options.minSampleTime.count() << ",\n";
+        out << "    \"compiler\": ";
+        writeJsonString(out, __VERSION__);
+        out << "\n  },\n";
+        out << "  \"benchmarks\": [";
+
+        for (std::size_t i = 0; i < results.size(); i++) {
+            const Result& result = results[i];
+
+            out << (i == 0 ? "\n" : ",\n");
+            out << "    {\"name\": ";
+            writeJsonString(out, result.name);
+            out << ", \"iterations\": " << result.iterations
+                << ", \"repetitions\": " << result.repetitions
+                << ", \"median_ns\": " << result.medianNs
+                << ", \"min_ns\": " << result.minNs
+                << ", \"mean_ns\": " << result.meanNs
+                << ", \"stddev_ns\": " << result.stddevNs << "}";
+        }
+
+        out << "\n  ]\n}\n";
+    }
+
+    struct OpcodeCase
+    {
+        const char* name;
+        std::uint16_t word;
+    };
+
+    // One representative word per handler, x = 1 and y = 2 where they
+    // apply. Fx55 and Fx65 use x = F, their most expensive form.
+    constexpr std::array<OpcodeCase, 34> opcodeCases = {{
+        { "CLS", 0x00E0 },
+        { "RET", 0x00EE },
+        { "JP_Addr", 0x1300 },
+        { "CALL_Addr", 0x2300 },
+        { "SE_Vx_Byte", 0x3105 },
+        { "SNE_Vx_Byte", 0x4105 },
+        { "SE_Vx_Vy", 0x5120 },
+        { "LD_Vx_Byte", 0x6105 },
+        { "ADD_Vx_Byte", 0x7105 },
+        { "LD_Vx_Vy", 0x8120 },
+        { "OR_Vx_Vy", 0x8121 },
+        { "AND_Vx_Vy", 0x8122 },
+        { "XOR_Vx_Vy", 0x8123 },
+        { "ADD_Vx_Vy", 0x8124 },
+        { "SUB_Vx_Vy", 0x8125 },
+        { "SHR_Vx_Vy", 0x8126 },
+        { "SUBN_Vx_Vy", 0x8127 },
+        { "SHL_Vx_Vy", 0x812E },
+        { "SNE_Vx_Vy", 0x9120 },
+        { "LD_I_Addr", 0xA300 },
+        { "JP_V0_Addr", 0xB300 },
+        { "RND_Vx_Byte", 0xC10F },
+        { "DRW_Vx_Vy_Nibble", 0xD125 },
+        { "SKP_Vx", 0xE19E },
+        { "SKNP_Vx", 0xE1A1 },
+        { "LD_Vx_DT", 0xF107 },
+        { "LD_Vx_K", 0xF10A },
+        { "LD_DT_Vx", 0xF115 },
+        { "LD_ST_Vx", 0xF118 },
+        { "ADD_I_Vx", 0xF11E },
+        { "LD_F_Vx", 0xF129 },
+        { "LD_B_Vx", 0xF133 },
+        { "LD_IAddr_Vx", 0xFF55 },
+        { "LD_Vx_IAddr", 0xFF65 }
+    }};
+
+    // Mixes arithmetic, a jump and a draw every six instructions
+    constexpr std::uint8_t loopProgram[] = {
+        0xA2, 0x0C, // LD I, 0x20C
+        0x70, 0x01, // ADD V0, 0x01
+        0x81, 0x04, // ADD V1, V0
+        0x82, 0x13, // XOR V2, V1
+        0xD0, 0x15, // DRW V0, V1, 5
+        0x12, 0x02, // JP 0x202
+        0xF0, 0x90, 0x90, 0x90, 0xF0
+    };
+
+    c8::cpu::CpuState makeOpcodeCpuState()
+    {
+        c8::cpu::CpuState cpuState{};
+
+        cpuState.pc = 0x200;
+        cpuState.ir = 0x300;
+        cpuState.sp = 1;
+        cpuState.stack[0] = 0x200;
+
+        for (std::uint8_t i = 0; i < 16; i++) {
+            cpuState.v[i] = static_cast<std::uint8_t>(i * 7 + 3);
+        }
+
+        return cpuState;
+    }
+
+    std::array<std::uint16_t, 64> makeWordMix()
+    {
+        std::array<std::uint16_t, 64> words;
+
+        for (std::size_t i = 0; i < words.size(); i++) {
+            words[i] = opcodeCases[i % opcodeCases.size()].word;
+        }
+
+        return words;
+    }
+
+    void addOpcodeBenchmarks(Suite& suite)
+    {
+        const c8::cpu::CpuState initial = makeOpcodeCpuState();
+
+        // Every handler benchmark includes this copy, which puts back the
+        // state the previous iteration changed
+        suite.run("cpu/reset state (baseline)", [&](std::uint64_t iterations) {
+            c8::cpu::CpuState cpuState;
+
+            for (std::uint64_t i = 0; i < iterations; i++) {
+                cpuState = initial;
+                doNotOptimize(cpuState);
+            }
+        });
+
+        for (const OpcodeCase& opcodeCase : opcodeCases) {
+            c8::Machine machine{0, 1};
+
+            suite.run(std::string{"cpu/"} + opcodeCase.name, [&](std::uint64_t iterations) {
+                c8::cpu::CpuState cpuState;
+
+                for (std::uint64_t i = 0; i < iterations; i++) {
+                    cpuState = initial;
+                    doNotOptimize(cpuState.execute(machine, opcodeCase.word));
+                }
+            });
+        }
+
+        const std::array<std::uint16_t, 64> words = makeWordMix();
+
+        suite.run("opcodes/decode", [&](std::uint64_t iterations) {
+            for (std::uint64_t i = 0; i < iterations; i++) {
+                doNotOptimize(c8::opcodes::decode(words[i % words.size()]));
+            }
+        });
+
+        suite.run("opcodes/formatOpcodeName", [&](std::uint64_t iterations) {
+            c8::format::Line line;
+
+            for (std::uint64_t i = 0; i < iterations; i++) {
+                c8::opcodes::formatOpcodeName(words[i % words.size()], line);
+                doNotOptimize(line);
+            }
+        });
+
+        suite.run("opcodes/getOpcodeName", [&](std::uint64_t iterations) {
+            for (std::uint64_t i = 0; i < iterations; i++) {
+                doNotOptimize(c8::opcodes::getOpcodeName(words[i % words.size()]));
+            }
+        });
+    }
+
+    void addVgaBenchmarks(Suite& suite)
+    {
+        c8::vga::VgaState vgaState;
+
+        suite.run("vga/drawByte", [&](std::uint64_t iterations) {
+            for (std::uint64_t i = 0; i < iterations; i++) {
+                doNotOptimize(vgaState.drawByte(i % 64, (i / 64) % 32, 0xA5));
+            }
+        });
+
+        suite.run("vga/clear", [&](std::uint64_t iterations) {
+            for (std::uint64_t i = 0; i < iterations; i++) {
+                vgaState.clear();
+                doNotOptimize(vgaState);
+            }
+        });
+
+        suite.run("vga/hash", [&](std::uint64_t iterations) {
+            for (std::uint64_t i = 0; i < iterations; i++) {
+                doNotOptimize(vgaState.hash());
+            }
+        });
+
+        // The pixel loop of the window's renderVga, without SFML
+        suite.run("vga/render scan", [&](std::uint64_t iterations) {
+            for (std::uint64_t i = 0; i < iterations; i++) {
+                int litPixels = 0;
+
+                for (std::uint8_t y = 0; y < c8::vga::frameBufferHeight; y++) {
+                    for (std::uint8_t x = 0; x < c8::vga::frameBufferWidth; x++) {
+                        litPixels += vgaState.getPixel(x, y) ? 1 : 0;
+                    }
+                }
+
+                doNotOptimize(litPixels);
+            }
+        });
+    }
+
+    void addMachineBenchmarks(Suite& suite)
+    {
+        // The difference between these two is the history copy
+        for (const std::size_t historyDepth : {std::size_t{0}, std::size_t{c8::cpu::maxCpuStates}}) {
+            c8::Machine machine{historyDepth, 1};
+
+            machine.loadProgram(loopProgram, sizeof(loopProgram));
+
+            const std::string name = historyDepth == 0
+                ? "machine/executeClockCycle history off"
+                : "machine/executeClockCycle history on";
+
+            suite.run(name, [&](std::uint64_t iterations) {
+                for (std::uint64_t i = 0; i < iterations; i++) {
+                    machine.executeClockCycle();
+                }
+
+                doNotOptimize(machine.getCpuState());
+            });
+        }
+
+        // Includes taking the records out again, which the trace writer
+        // does on its own thread
+        {
+            c8::Machine tracedMachine{0, 1};
+
+            tracedMachine.loadProgram(loopProgram, sizeof(loopProgram));
+
+            const auto recorder = std::make_unique<c8::trace::Recorder>();
+
+            std::vector<c8::trace::Record> records(4096);
+
+            suite.run("machine/executeClockCycle trace", [&](std::uint64_t iterations) {
+                for (std::uint64_t i = 0; i < iterations; i++) {
+                    tracedMachine.executeClockCycle(*recorder);
+
+                    if (i % records.size() == records.size() - 1) {
+                        recorder->take(records.data(), records.size());
+                    }
+                }
+
+                recorder->take(records.data(), records.size());
+            });
+        }
+
+        c8::Machine machine{c8::cpu::maxCpuStates, 1, true};
+
+        machine.loadProgram(loopProgram, sizeof(loopProgram));
+
+        c8::cpu::Snapshot snapshot;
+
+        suite.run("machine/takeSnapshot", [&](std::uint64_t iterations) {
+            for (std::uint64_t i = 0; i < iterations; i++) {
+                machine.executeClockCycle();
+                machine.takeSnapshot(snapshot);
+                doNotOptimize(snapshot);
+            }
+        });
+    }
+
+    struct CommandLine
+    {
+        Options options;
+
+        std::string jsonPath;
+    };
+
+    bool parseArgs(int argc, char** argv, CommandLine& commandLine)
+    {
+        std::vector<std::string> args;
+
+        args.assign(argv + 1, argv + argc);
+
+        for (std::size_t i = 0; i < args.size(); i++) {
+            const std::string& arg = args[i];
+
+            if (arg == "--repetitions" && i + 1 < args.size()) {
+                commandLine.options.repetitions = std::stoi(args[++i]);
+                continue;
+            }
+
+            if (arg == "--min-time" && i + 1 < args.size()) {
+                commandLine.options.minSampleTime = std::chrono::milliseconds{std::stoi(args[++i])};
+                continue;
+            }
+
+            if (arg == "--filter" && i + 1 < args.size()) {
+                commandLine.options.filter = args[++i];
+                continue;
+            }
+
+            if (arg == "--json" && i + 1 < args.size()) {
+                commandLine.jsonPath = args[++i];
+                continue;
+            }
+
+            return false;
+        }
+
+        return commandLine.options.repetitions > 0;
+    }
+
+    int run(int argc, char** argv)
+    {
+        CommandLine commandLine;
+
+        if (!parseArgs(argc, argv, commandLine)) {
+            std::cerr << "Usage: " << argv[0] << " [--repetitions N] [--min-time ms] [--filter text] [--json file]\n";
+            return 1;
+        }
+
+        Suite suite{commandLine.options};
+
+        addOpcodeBenchmarks(suite);
+        addVgaBenchmarks(suite);
+        addMachineBenchmarks(suite);
+
+        // With --json - the JSON is all that goes to stdout
+        if (commandLine.jsonPath == "-") {
+            suite.writeJson(std::cout);
+            return 0;
+        }
+
+        suite.writeText(std::cout);
+
+        if (commandLine.jsonPath.empty()) {
+            return 0;
+        }
+
+        std::ofstream out{commandLine.jsonPath};
+
+        if (!out.is_open()) {
+            std::cerr << "Could not open " << commandLine.jsonPath << "\n";
+            return 1;
+        }
+
+        suite.writeJson(out);
+
+        return 0;
+    }
+}
@@ -0,0 +1,97 @@
+/**
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace c8::bench
+{
+    /**
+     * Keeps the compiler from optimizing away a value that is only computed
+     * to be measured
+    */
+    template <typename T>
+    inline void doNotOptimize(const T& value)
+    {
+        asm volatile("" : : "r,m"(value) : "memory");
+    }
+
+    struct Options
+    {
+        // Each sample runs the benchmark for at least this long
+        std::chrono::nanoseconds minSampleTime = std::chrono::milliseconds{10};
+
+        int repetitions = 10;
+
+        // Only benchmarks whose name contains this are run
+        std::string filter;
+    };
+
+    /**
+     * Nanoseconds per operation over all samples of one benchmark
+    */
+    struct Result
+    {
+        std::string name;
+
+        std::uint64_t iterations = 0;
+        int repetitions = 0;
+
+        double minNs = 0;
+        double medianNs = 0;
+        double meanNs = 0;
+        double stddevNs = 0;
+    };
+
+    /**
+     * Runs benchmarks and collects their results. A benchmark is a function
+     * that performs the measured operation the given number of times, so
+     * the loop itself costs no indirect call.
+    */
+    class Suite
+    {
+    private:
+        Options options;
+
+        std::vector<Result> results;
+
+    public:
+        explicit Suite(const Options& options);
+
+        void run(const std::string& name, const std::function<void(std::uint64_t)>& body);
+
+        const std::vector<Result>& getResults() const;
+
+        void writeText(std::ostream& out) const;
+
+        void writeJson(std::ostream& out) const;
+    };
+
+    /**
+     * Runs the microbenchmarks of the emulator core and prints ns/op for
+     * each. Returns the process exit code.
+     *
+     * Usage: [--repetitions N] [--min-time ms] [--filter text] [--json file]
+     *
+     * --json - writes only the JSON, to stdout.
+    */
+    int run(int argc, char** argv);
+}
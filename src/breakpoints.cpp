@@ -0,0 +1,45 @@
+/**
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "breakpoints.hpp"
+
+namespace c8::breakpoints
+{
+    int Bitmap::getCount() const
+    {
+        return count;
+    }
+
+    void Bitmap::set(const std::uint16_t addr, const bool enabled)
+    {
+        if (addr >= addressCount || contains(addr) == enabled) {
+            return;
+        }
+
+        words[addr / 64] ^= std::uint64_t{1} << (addr % 64);
+        count += enabled ? 1 : -1;
+    }
+
+    void Bitmap::toggle(const std::uint16_t addr)
+    {
+        set(addr, !contains(addr));
+    }
+
+    void Bitmap::clear()
+    {
+        words.fill(0);
+        count = 0;
+    }
+}
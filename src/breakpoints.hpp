@@ -0,0 +1,60 @@
+/**
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+namespace c8::breakpoints
+{
+    // One bit per address of the 4 KB address space
+    inline constexpr int addressCount = 4096;
+
+    /**
+     * PC breakpoints as a bitmap, so checking an address is a single bit
+     * test. The number set is kept too, so a run loop can tell there are
+     * none without looking at the bits.
+    */
+    class Bitmap
+    {
+    private:
+        std::array<std::uint64_t, addressCount / 64> words{};
+
+        int count = 0;
+
+    public:
+        bool contains(const std::uint16_t addr) const
+        {
+            return addr < addressCount && ((words[addr / 64] >> (addr % 64)) & 1) != 0;
+        }
+
+        bool isEmpty() const
+        {
+            return count == 0;
+        }
+
+        int getCount() const;
+
+        /**
+         * Addresses outside the address space are ignored
+        */
+        void set(const std::uint16_t addr, const bool enabled);
+
+        void toggle(const std::uint16_t addr);
+
+        void clear();
+    };
+}
@@ -0,0 +1,143 @@
+/**
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef C8_H
+#define C8_H
+
+/*
+ * C interface to the emulator core, built as the c8 shared library.
+ *
+ * Every function takes a machine created by c8_create. Passing NULL
+ * instead is safe: functions returning c8_result return
+ * C8_ERROR_INVALID_ARGUMENT, c8_frame_buffer returns NULL and the others
+ * do nothing. Machines do not share any state, so different machines may
+ * be used from different threads at the same time; a single machine may
+ * not. Only c8_create and c8_load_rom allocate memory. c8_load_rom gives
+ * the machine its own copy of every memory page so that running,
+ * resetting and restoring states never has to.
+*/
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+#if defined(C8_BUILDING_LIBRARY)
+#define C8_API __declspec(dllexport)
+#else
+#define C8_API __declspec(dllimport)
+#endif
+#else
+#define C8_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Changes whenever a function or the layout of a struct below changes */
+#define C8_API_VERSION 1
+
+#define C8_FRAME_WIDTH 64
+#define C8_FRAME_HEIGHT 32
+
+typedef struct c8_machine c8_machine;
+
+typedef enum c8_result
+{
+    C8_OK = 0,
+    C8_ERROR_INVALID_ARGUMENT = -1,
+    C8_ERROR_ROM_TOO_LARGE = -2,
+    C8_ERROR_BUFFER_TOO_SMALL = -3,
+    C8_ERROR_INVALID_STATE = -4
+} c8_result;
+
+typedef struct c8_registers
+{
+    uint16_t pc;
+    uint16_t i;
+    uint8_t dt;
+    uint8_t st;
+    uint8_t sp;
+    uint8_t v[16];
+} c8_registers;
+
+/**
+ * Returns C8_API_VERSION of the library that is loaded
+*/
+C8_API int c8_api_version(void);
+
+/**
+ * Creates a machine with the default program loaded. The seed drives the
+ * random number generator, so equal seeds and inputs give equal runs.
+ * Returns NULL if out of memory.
+*/
+C8_API c8_machine* c8_create(uint32_t seed);
+
+C8_API void c8_destroy(c8_machine* machine);
+
+/**
+ * Copies size bytes of rom to 0x200 and resets the machine
+*/
+C8_API c8_result c8_load_rom(c8_machine* machine, const uint8_t* rom, size_t size);
+
+/**
+ * Restarts the loaded rom from 0x200
+*/
+C8_API void c8_reset(c8_machine* machine);
+
+/**
+ * Executes cycles clock cycles. DT and ST count down 60 times per 500
+ * cycles.
+*/
+C8_API void c8_run_cycles(c8_machine* machine, uint64_t cycles);
+
+/**
+ * Bit n of keys set means key n is held down
+*/
+C8_API void c8_set_keypad(c8_machine* machine, uint16_t keys);
+
+/**
+ * The C8_FRAME_HEIGHT rows of the frame buffer, one bit per pixel with
+ * x = 0 in the most significant bit. The pointer stays valid, and its
+ * contents current, until the machine is destroyed.
+*/
+C8_API const uint64_t* c8_frame_buffer(const c8_machine* machine);
+
+/**
+ * Does nothing if registers is NULL
+*/
+C8_API void c8_get_registers(const c8_machine* machine, c8_registers* registers);
+
+/**
+ * Number of bytes c8_save_state writes
+*/
+C8_API size_t c8_state_size(void);
+
+/**
+ * Writes the complete machine state into buffer, which must hold at least
+ * c8_state_size() bytes
+*/
+C8_API c8_result c8_save_state(const c8_machine* machine, void* buffer, size_t size);
+
+/**
+ * Restores a state written by c8_save_state of the same library version
+*/
+C8_API c8_result c8_restore_state(c8_machine* machine, const void* buffer, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
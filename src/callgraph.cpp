@@ -0,0 +1,239 @@
+/**
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "callgraph.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <string>
+
+#include "format.hpp"
+
+namespace c8::callgraph
+{
+    Profiler::Profiler()
+    {
+        clear();
+    }
+
+    void Profiler::clear()
+    {
+        nodes.clear();
+        nodes.push_back({0x200, -1});
+        nodes.front().calls = 1;
+
+        stack.fill(0);
+        depth = 0;
+
+        lastTransition = clock::now();
+    }
+
+    void Profiler::chargeHostTime()
+    {
+        const clock::time_point now = clock::now();
+
+        nodes[stack[depth]].hostNs += std::chrono::duration_cast<std::chrono::nanoseconds>(now - lastTransition).count();
+
+        lastTransition = now;
+    }
+
+    void Profiler::flushHostTime()
+    {
+        chargeHostTime();
+    }
+
+    void Profiler::call(const std::uint16_t address)
+    {
+        // The CPU ignores a CALL with a full stack
+        if (depth == c8::cpu::maxStackDepth) {
+            return;
+        }
+
+        chargeHostTime();
+
+        const int parent = stack[depth];
+
+        int child = nodes[parent].firstChild;
+
+        while (child != -1 && nodes[child].address != address) {
+            child = nodes[child].nextSibling;
+        }
+
+        if (child == -1 && nodes.size() < maxNodes) {
+            child = static_cast<int>(nodes.size());
+
+            Node& node = nodes.emplace_back();
+
+            node.address = address;
+            node.parent = parent;
+            node.nextSibling = nodes[parent].firstChild;
+
+            nodes[parent].firstChild = child;
+        }
+
+        if (child == -1) {
+            child = parent;
+        }
+
+        nodes[child].calls++;
+
+        stack[++depth] = child;
+    }
+
+    void Profiler::ret()
+    {
+        // The CPU ignores a RET with an empty stack
+        if (depth == 0) {
+            return;
+        }
+
+        chargeHostTime();
+
+        depth--;
+    }
+
+    std::uint64_t Profiler::getTotalCycles() const
+    {
+        std::uint64_t total = 0;
+
+        for (const Node& node : nodes) {
+            total += node.cycles;
+        }
+
+        return total;
+    }
+
+    void Profiler::computeInclusive(std::vector<std::uint64_t>& cycles, std::vector<std::uint64_t>& hostNs) const
+    {
+        cycles.resize(nodes.size());
+        hostNs.resize(nodes.size());
+
+        for (std::size_t i = 0; i < nodes.size(); i++) {
+            cycles[i] = nodes[i].cycles;
+            hostNs[i] = nodes[i].hostNs;
+        }
+
+        // Children are always created after their parent
+        for (std::size_t i = nodes.size() - 1; i > 0; i--) {
+            cycles[nodes[i].parent] += cycles[i];
+            hostNs[nodes[i].parent] += hostNs[i];
+        }
+    }
+
+    std::vector<Subroutine> Profiler::getSubroutines() const
+    {
+        std::vector<std::uint64_t> inclusiveCycles;
+        std::vector<std::uint64_t> inclusiveHostNs;
+
+        computeInclusive(inclusiveCycles, inclusiveHostNs);
+
+        std::vector<Subroutine> subroutines;
+        std::array<int, c8::mem::maxBufferSize> indexByAddress;
+
+        indexByAddress.fill(-1);
+
+        for (std::size_t i = 0; i < nodes.size(); i++) {
+            const Node& node = nodes[i];
+
+            int& index = indexByAddress[node.address % c8::mem::maxBufferSize];
+
+            if (index == -1) {
+                index = static_cast<int>(subroutines.size());
+                subroutines.push_back({node.address, 0, 0, 0, 0, 0});
+            }
+
+            Subroutine& subroutine = subroutines[index];
+
+            subroutine.calls += node.calls;
+            subroutine.exclusiveCycles += node.cycles;
+            subroutine.exclusiveHostNs += node.hostNs;
+
+            // A recursive call is already inside the inclusive count of the
+            // outer one
+            bool isRecursive = false;
+
+            for (int parent = node.parent; parent != -1; parent = nodes[parent].parent) {
+                isRecursive = isRecursive || nodes[parent].address == node.address;
+            }
+
+            if (!isRecursive) {
+                subroutine.inclusiveCycles += inclusiveCycles[i];
+                subroutine.inclusiveHostNs += inclusiveHostNs[i];
+            }
+        }
+
+        std::stable_sort(subroutines.begin(), subroutines.end(), [](const Subroutine& a, const Subroutine& b) {
+            return a.inclusiveCycles > b.inclusiveCycles;
+        });
+
+        return subroutines;
+    }
+
+    void Profiler::writeReport(std::ostream& out) const
+    {
+        const std::vector<Subroutine> subroutines = getSubroutines();
+
+        const double totalCycles = static_cast<double>(std::max<std::uint64_t>(getTotalCycles(), 1));
+
+        out << "address      calls   incl cycles  incl %   excl cycles  excl %    incl ms    excl ms\n";
+
+        c8::format::Line address;
+
+        for (const Subroutine& subroutine : subroutines) {
+            address.clear().appendHex(subroutine.address, false);
+
+            out << address.view()
+                << std::setw(11) << subroutine.calls
+                << std::setw(14) << subroutine.inclusiveCycles
+                << std::fixed << std::setprecision(1)
+                << std::setw(8) << 100 * subroutine.inclusiveCycles / totalCycles
+                << std::setw(14) << subroutine.exclusiveCycles
+                << std::setw(8) << 100 * subroutine.exclusiveCycles / totalCycles
+                << std::setprecision(3)
+                << std::setw(11) << subroutine.inclusiveHostNs / 1e6
+                << std::setw(11) << subroutine.exclusiveHostNs / 1e6
+                << std::defaultfloat << "\n";
+        }
+    }
+
+    void Profiler::writeCollapsed(std::ostream& out, const Weight weight) const
+    {
+        c8::format::Line address;
+
+        std::array<int, c8::cpu::maxStackDepth + 1> path;
+
+        for (std::size_t i = 0; i < nodes.size(); i++) {
+            const std::uint64_t value = weight == Weight::Cycles ? nodes[i].cycles : nodes[i].hostNs;
+
+            if (value == 0) {
+                continue;
+            }
+
+            std::size_t length = 0;
+
+            for (int node = static_cast<int>(i); node != -1 && length < path.size(); node = nodes[node].parent) {
+                path[length++] = node;
+            }
+
+            for (std::size_t j = length; j > 0; j--) {
+                address.clear().appendHex(nodes[path[j - 1]].address, false);
+
+                out << address.view() << (j > 1 ? ";" : " ");
+            }
+
+            out << value << "\n";
+        }
+    }
+}
@@ -0,0 +1,147 @@
+/**
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include "cpu.hpp"
+
+namespace c8::callgraph
+{
+    // Calls that would need more tree nodes than this are charged to the
+    // caller instead
+    inline constexpr std::size_t maxNodes = 1 << 16;
+
+    enum class Weight
+    {
+        Cycles,
+        HostNanoseconds
+    };
+
+    /**
+     * Totals for one subroutine, keyed by its entry address. Inclusive
+     * counts cover the subroutine and everything it called, counted once
+     * when it recurses.
+    */
+    struct Subroutine
+    {
+        std::uint16_t address;
+
+        std::uint64_t calls;
+
+        std::uint64_t inclusiveCycles;
+        std::uint64_t exclusiveCycles;
+
+        std::uint64_t inclusiveHostNs;
+        std::uint64_t exclusiveHostNs;
+    };
+
+    /**
+     * Counter policy for Machine::executeClockCycle that keeps a shadow call
+     * stack from CALL and RET and charges every executed instruction to the
+     * call path it ran in. Host time is only read on CALL and RET, so the
+     * per instruction cost is one increment.
+     *
+     * Code outside any subroutine is charged to the root, entry 0x200.
+    */
+    class Profiler
+    {
+    private:
+        using clock = std::chrono::steady_clock;
+
+        // One node per distinct call path
+        struct Node
+        {
+            std::uint16_t address;
+
+            int parent;
+            int firstChild = -1;
+            int nextSibling = -1;
+
+            std::uint64_t calls = 0;
+            std::uint64_t cycles = 0;
+            std::uint64_t hostNs = 0;
+        };
+
+        std::vector<Node> nodes;
+
+        // Mirrors the CPU stack, entry 0 is the root
+        std::array<int, c8::cpu::maxStackDepth + 1> stack;
+        std::size_t depth = 0;
+
+        clock::time_point lastTransition;
+
+        void chargeHostTime();
+
+        void call(const std::uint16_t address);
+
+        void ret();
+
+        /**
+         * Inclusive cycles and host time of each node, from the leaves up
+        */
+        void computeInclusive(std::vector<std::uint64_t>& cycles, std::vector<std::uint64_t>& hostNs) const;
+
+    public:
+        static constexpr bool enabled = true;
+
+        Profiler();
+
+        void count(const std::uint16_t, const std::uint16_t word)
+        {
+            nodes[stack[depth]].cycles++;
+
+            if ((word & 0xF000) == 0x2000) {
+                call(word & 0x0FFF);
+            } else if (word == 0x00EE) {
+                ret();
+            }
+        }
+
+        /**
+         * Forgets everything, for when the machine is reset
+        */
+        void clear();
+
+        /**
+         * Charges the host time since the last CALL or RET to the running
+         * subroutine. Call before reading the results.
+        */
+        void flushHostTime();
+
+        std::uint64_t getTotalCycles() const;
+
+        /**
+         * Totals per subroutine, most inclusive cycles first
+        */
+        std::vector<Subroutine> getSubroutines() const;
+
+        /**
+         * A table of getSubroutines
+        */
+        void writeReport(std::ostream& out) const;
+
+        /**
+         * One "0x0200;0x0246;0x0300 <weight>" line per call path, as read by
+         * flamegraph.pl and compatible tools
+        */
+        void writeCollapsed(std::ostream& out, const Weight weight = Weight::Cycles) const;
+    };
+}
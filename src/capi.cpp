@@ -0,0 +1,195 @@
+/**
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "c8.h"
+
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <type_traits>
+
+#include "machine.hpp"
+
+struct c8_machine
+{
+    c8::Machine machine;
+
+    explicit c8_machine(const std::uint32_t seed) :
+        machine(0, seed)
+    {
+    }
+};
+
+namespace c8::capi
+{
+    // Written in front of every saved state so that a buffer from another
+    // library version, or one that is not a state at all, is rejected
+    struct StateHeader
+    {
+        std::uint32_t magic;
+        std::uint32_t version;
+    };
+
+    constexpr std::uint32_t stateMagic = 0x38504843; // "CHP8"
+
+    constexpr std::size_t stateSize = sizeof(StateHeader) + sizeof(c8::Machine::SavedState);
+
+    static_assert(std::is_trivially_copyable_v<c8::Machine::SavedState>);
+}
+
+int c8_api_version(void)
+{
+    return C8_API_VERSION;
+}
+
+c8_machine* c8_create(uint32_t seed)
+{
+    return new (std::nothrow) c8_machine{seed};
+}
+
+void c8_destroy(c8_machine* machine)
+{
+    delete machine;
+}
+
+c8_result c8_load_rom(c8_machine* machine, const uint8_t* rom, size_t size)
+{
+    if (machine == nullptr || (rom == nullptr && size > 0)) {
+        return C8_ERROR_INVALID_ARGUMENT;
+    }
+
+    if (!machine->machine.loadProgram(rom, size)) {
+        return C8_ERROR_ROM_TOO_LARGE;
+    }
+
+    // Pages still shared with the loaded program would be copied on the
+    // first write, inside c8_run_cycles
+    machine->machine.getMemory().unsharePages();
+
+    return C8_OK;
+}
+
+void c8_reset(c8_machine* machine)
+{
+    if (machine == nullptr) {
+        return;
+    }
+
+    machine->machine.reset();
+}
+
+void c8_run_cycles(c8_machine* machine, uint64_t cycles)
+{
+    if (machine == nullptr) {
+        return;
+    }
+
+    for (uint64_t i = 0; i < cycles; i++) {
+        machine->machine.executeClockCycle();
+    }
+}
+
+void c8_set_keypad(c8_machine* machine, uint16_t keys)
+{
+    if (machine == nullptr) {
+        return;
+    }
+
+    machine->machine.setKeypad(keys);
+}
+
+const uint64_t* c8_frame_buffer(const c8_machine* machine)
+{
+    if (machine == nullptr) {
+        return nullptr;
+    }
+
+    return machine->machine.getVgaState().getRows();
+}
+
+void c8_get_registers(const c8_machine* machine, c8_registers* registers)
+{
+    if (machine == nullptr || registers == nullptr) {
+        return;
+    }
+
+    const c8::cpu::CpuState& cpuState = machine->machine.getCpuState();
+
+    registers->pc = cpuState.pc;
+    registers->i = cpuState.ir;
+    registers->dt = cpuState.dt;
+    registers->st = cpuState.st;
+    registers->sp = cpuState.sp;
+
+    std::memcpy(registers->v, cpuState.v.data(), sizeof(registers->v));
+}
+
+size_t c8_state_size(void)
+{
+    return c8::capi::stateSize;
+}
+
+c8_result c8_save_state(const c8_machine* machine, void* buffer, size_t size)
+{
+    if (machine == nullptr || buffer == nullptr) {
+        return C8_ERROR_INVALID_ARGUMENT;
+    }
+
+    if (size < c8::capi::stateSize) {
+        return C8_ERROR_BUFFER_TOO_SMALL;
+    }
+
+    const c8::capi::StateHeader header{c8::capi::stateMagic, C8_API_VERSION};
+
+    c8::Machine::SavedState state;
+
+    machine->machine.saveState(state);
+
+    auto* bytes = static_cast<unsigned char*>(buffer);
+
+    std::memcpy(bytes, &header, sizeof(header));
+    std::memcpy(bytes + sizeof(header), &state, sizeof(state));
+
+    return C8_OK;
+}
+
+c8_result c8_restore_state(c8_machine* machine, const void* buffer, size_t size)
+{
+    if (machine == nullptr || buffer == nullptr) {
+        return C8_ERROR_INVALID_ARGUMENT;
+    }
+
+    if (size < c8::capi::stateSize) {
+        return C8_ERROR_BUFFER_TOO_SMALL;
+    }
+
+    const auto* bytes = static_cast<const unsigned char*>(buffer);
+
+    c8::capi::StateHeader header;
+
+    std::memcpy(&header, bytes, sizeof(header));
+
+    if (header.magic != c8::capi::stateMagic || header.version != C8_API_VERSION) {
+        return C8_ERROR_INVALID_STATE;
+    }
+
+    c8::Machine::SavedState state;
+
+    std::memcpy(&state, bytes + sizeof(header), sizeof(state));
+
+    machine->machine.restoreState(state);
+
+    return C8_OK;
+}
@@ -0,0 +1,129 @@
+/**
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "machine.hpp"
+
+// Measures how fast a machine can be forked, as a tree search over inputs
+// does it: clone the parent, run a few cycles on the clone, discard it.
+//
+// Usage: c8-clone-bench [--clones N] [--cycles N] [--warmup N] rom
+
+struct Options
+{
+    std::string romPath;
+
+    std::uint64_t clones = 100'000;
+    int cycles = 100;
+
+    // Cycles the parent runs first, so the clones start from a machine
+    // that has already drawn and written to memory
+    int warmupCycles = 1000;
+};
+
+bool parseArgs(int argc, char** argv, Options& options)
+{
+    std::vector<std::string> args;
+
+    args.assign(argv + 1, argv + argc);
+
+    for (std::size_t i = 0; i < args.size(); i++) {
+        const std::string& arg = args[i];
+
+        if (arg == "--clones" && i + 1 < args.size()) {
+            options.clones = std::stoull(args[++i]);
+            continue;
+        }
+
+        if (arg == "--cycles" && i + 1 < args.size()) {
+            options.cycles = std::stoi(args[++i]);
+            continue;
+        }
+
+        if (arg == "--warmup" && i + 1 < args.size()) {
+            options.warmupCycles = std::stoi(args[++i]);
+            continue;
+        }
+
+        options.romPath = arg;
+    }
+
+    return !options.romPath.empty() && options.clones > 0;
+}
+
+int main(int argc, char** argv)
+{
+    using clock = std::chrono::steady_clock;
+
+    Options options;
+
+    if (!parseArgs(argc, argv, options)) {
+        std::cerr << "Usage: " << argv[0] << " [--clones N] [--cycles N] [--warmup N] rom\n";
+        return 1;
+    }
+
+    std::ifstream file{options.romPath, std::ios::binary};
+
+    if (!file.is_open()) {
+        std::cerr << "Could not open " << options.romPath << "\n";
+        return 1;
+    }
+
+    c8::Machine parent{0, 1};
+
+    parent.loadProgram(file);
+
+    for (int i = 0; i < options.warmupCycles; i++) {
+        parent.executeClockCycle();
+    }
+
+    std::uint64_t sharedPages = 0;
+    std::uint64_t checksum = 0;
+
+    const auto start = clock::now();
+
+    for (std::uint64_t i = 0; i < options.clones; i++) {
+        const std::unique_ptr<c8::Machine> child = parent.clone();
+
+        // Different keys per clone, like the branches of a search
+        child->setKeypad(static_cast<std::uint16_t>(1u << (i % 16)));
+
+        for (int cycle = 0; cycle < options.cycles; cycle++) {
+            child->executeClockCycle();
+        }
+
+        sharedPages += child->getMemory().getSharedPageCount();
+        checksum += child->getCpuState().pc;
+    }
+
+    const std::chrono::duration<double> wallTime = clock::now() - start;
+
+    std::cout << "clones               " << options.clones << "\n";
+    std::cout << "cycles per clone     " << options.cycles << "\n";
+    std::cout << "shared pages/clone   " << static_cast<double>(sharedPages) / options.clones
+              << " of " << c8::mem::pageCount << "\n";
+    std::cout << "clones/s             " << options.clones / wallTime.count() << "\n";
+    std::cout << "ns per clone         " << wallTime.count() * 1e9 / options.clones << "\n";
+    std::cout << "checksum             " << checksum << "\n";
+
+    return 0;
+}
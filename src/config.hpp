@@ -16,24 +16,44 @@
 #pragma once
 
 #include <chrono>
-#include <SFML/Graphics.hpp>
+#include <cstdint>
+
 #include "vga.hpp"
 
 namespace c8::config
 {
     inline constexpr int targetHostFps = 60;
-    inline constexpr auto targetHostFpsRatio = std::chrono::duration<int, std::ratio<1, targetHostFps>>{1};
 
     inline constexpr int targetCpuFrequency = 500;
-    inline constexpr double targetCpuCyclesPerFrame = targetCpuFrequency / targetHostFps;
+
+    // DT and ST tick at this rate in emulated time
+    inline constexpr int timerFrequency = 60;
+
+    // How long before a frame deadline the pacer stops sleeping and starts
+    // spinning, this should cover the OS timer slack
+    inline constexpr auto pacingSpinMargin = std::chrono::microseconds{1500};
+
+    // After a host stall, at most this many extra cycles run per frame to
+    // catch up, and at most maxBacklogCycles are remembered at all
+    inline constexpr int maxCatchUpCyclesPerFrame = targetCpuFrequency / targetHostFps * 4;
+    inline constexpr int maxBacklogCycles = targetCpuFrequency * 2;
+
+    // With frame skipping enabled, at most this many frames in a row are
+    // skipped while emulation is behind wall time
+    inline constexpr int maxSkippedFrames = 4;
 
     inline constexpr bool showEmulatorInfo = true;
 
+    // Counts executed instructions by opcode and address for the info
+    // panel. When false the counting is compiled out.
+    inline constexpr bool countInstructions = true;
+
     inline constexpr int pixelWidth = 16;
     inline constexpr int pixelHeight = 16;
 
-    inline const sf::Color backgroundColor = sf::Color::Black;
-    inline const sf::Color pixelColor = sf::Color::Green;
+    // Colors are packed as 0xRRGGBBAA
+    inline constexpr std::uint32_t backgroundColor = 0x000000FF;
+    inline constexpr std::uint32_t pixelColor = 0x00FF00FF;
 
     inline unsigned int getRenderWidth()
     {
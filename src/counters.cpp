@@ -0,0 +1,126 @@
+/**
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "counters.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <vector>
+
+namespace c8::counters
+{
+    void InstructionCounters::clear()
+    {
+        perOpcode.fill(0);
+        perAddress.fill(0);
+        total = 0;
+    }
+
+    std::uint64_t InstructionCounters::getTotal() const
+    {
+        return total;
+    }
+
+    std::uint64_t InstructionCounters::getOpcodeCount(const c8::opcodes::Opcode opcode) const
+    {
+        return perOpcode[static_cast<int>(opcode) + 1];
+    }
+
+    std::uint64_t InstructionCounters::getAddressCount(const std::uint16_t addr) const
+    {
+        return addr < c8::mem::maxBufferSize ? perAddress[addr] : 0;
+    }
+
+    // Keeps list sorted by count, most first, with the largest counts seen
+    void insertTop(TopList& list, const int key, const std::uint64_t count)
+    {
+        if (count <= list.back().count) {
+            return;
+        }
+
+        std::size_t i = list.size() - 1;
+
+        while (i > 0 && list[i - 1].count < count) {
+            list[i] = list[i - 1];
+            i--;
+        }
+
+        list[i] = {key, count};
+    }
+
+    void InstructionCounters::fillTop(TopList& opcodes, TopList& addresses) const
+    {
+        opcodes.fill({0, 0});
+        addresses.fill({0, 0});
+
+        for (int i = 0; i < c8::opcodes::opcodeCount; i++) {
+            insertTop(opcodes, i - 1, perOpcode[i]);
+        }
+
+        for (int addr = 0; addr < c8::mem::maxBufferSize; addr++) {
+            insertTop(addresses, addr, perAddress[addr]);
+        }
+    }
+
+    struct CsvRow
+    {
+        int key;
+        std::uint64_t count;
+    };
+
+    void writeRows(std::ostream& out, std::vector<CsvRow>& rows, const std::uint64_t total, const bool isOpcode)
+    {
+        std::stable_sort(rows.begin(), rows.end(), [](const CsvRow& a, const CsvRow& b) {
+            return a.count > b.count;
+        });
+
+        for (const CsvRow& row : rows) {
+            if (isOpcode) {
+                out << "opcode," << c8::opcodes::getOpcodeIdentifier(static_cast<c8::opcodes::Opcode>(row.key));
+            } else {
+                out << "address,0x" << std::hex << std::uppercase << std::setw(4) << std::setfill('0') << row.key
+                    << std::dec << std::nouppercase << std::setfill(' ');
+            }
+
+            out << ',' << row.count << ',' << std::fixed << std::setprecision(3)
+                << (total > 0 ? 100.0 * row.count / total : 0.0) << std::defaultfloat << "\n";
+        }
+    }
+
+    void InstructionCounters::writeCsv(std::ostream& out) const
+    {
+        std::vector<CsvRow> rows;
+
+        out << "kind,key,count,percent\n";
+
+        for (int i = 0; i < c8::opcodes::opcodeCount; i++) {
+            if (perOpcode[i] > 0) {
+                rows.push_back({i - 1, perOpcode[i]});
+            }
+        }
+
+        writeRows(out, rows, total, true);
+
+        rows.clear();
+
+        for (int addr = 0; addr < c8::mem::maxBufferSize; addr++) {
+            if (perAddress[addr] > 0) {
+                rows.push_back({addr, perAddress[addr]});
+            }
+        }
+
+        writeRows(out, rows, total, false);
+    }
+}
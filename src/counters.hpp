@@ -0,0 +1,108 @@
+/**
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <ostream>
+
+#include "memory.hpp"
+#include "opcodes.hpp"
+
+namespace c8::counters
+{
+    // Entries shown per list in the info panel
+    inline constexpr int topCount = 3;
+
+    /**
+     * key is the Opcode value for instructions and the address for
+     * addresses. Unused entries have a count of 0.
+    */
+    struct TopEntry
+    {
+        int key;
+        std::uint64_t count;
+    };
+
+    using TopList = std::array<TopEntry, topCount>;
+
+    /**
+     * Counter policy for Machine::executeClockCycle that counts nothing.
+     * Every call is empty, so the counting compiles away.
+    */
+    struct NoCounters
+    {
+        static constexpr bool enabled = false;
+
+        void count(const std::uint16_t, const std::uint16_t)
+        {
+        }
+
+        std::uint64_t getTotal() const
+        {
+            return 0;
+        }
+
+        void fillTop(TopList& opcodes, TopList& addresses) const
+        {
+            opcodes.fill({0, 0});
+            addresses.fill({0, 0});
+        }
+    };
+
+    /**
+     * Counter policy for Machine::executeClockCycle that counts every
+     * executed instruction by Opcode and by address
+    */
+    class InstructionCounters
+    {
+    private:
+        // Indexed by the Opcode value plus one, so Invalid comes first
+        std::array<std::uint64_t, c8::opcodes::opcodeCount> perOpcode{};
+        std::array<std::uint64_t, c8::mem::maxBufferSize> perAddress{};
+
+        std::uint64_t total = 0;
+
+    public:
+        static constexpr bool enabled = true;
+
+        void count(const std::uint16_t pc, const std::uint16_t word)
+        {
+            perOpcode[static_cast<int>(c8::opcodes::decode(word)) + 1]++;
+            perAddress[pc % c8::mem::maxBufferSize]++;
+            total++;
+        }
+
+        void clear();
+
+        std::uint64_t getTotal() const;
+
+        std::uint64_t getOpcodeCount(const c8::opcodes::Opcode opcode) const;
+
+        std::uint64_t getAddressCount(const std::uint16_t addr) const;
+
+        /**
+         * The most executed instructions and addresses, most first
+        */
+        void fillTop(TopList& opcodes, TopList& addresses) const;
+
+        /**
+         * Writes "kind,key,count,percent" lines, every Opcode and then
+         * every address that was executed at least once, most first
+        */
+        void writeCsv(std::ostream& out) const;
+    };
+}
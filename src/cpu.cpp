@@ -16,759 +16,580 @@
 #include <array>
 
 #include "cpu.hpp"
+#include "machine.hpp"
 #include "opcodes.hpp"
 #include "memory.hpp"
 #include "vga.hpp"
-#include "ui.hpp"
 
 namespace c8::cpu
 {
-    std::random_device rd;
-    std::mt19937 generator{rd()};
-    std::uniform_int_distribution<int> distribution{0, 255};
-
-    int cpuHertz;
-    int hostFps;
-
-    bool paused;
-    bool doAdvanceOneClockCycle;
-    bool waitingForKeyboard;
+    std::uint8_t* CpuState::getRegister(const std::uint8_t index)
+    {
+        if (index > 0xF) {
+            return nullptr;
+        }
 
-    std::uint8_t keyboardPressedValue;
+        return &v[index];
+    }
 
-    class CpuState
+    std::uint16_t CpuState::popFromStack()
     {
-    public:
-        c8::vga::VgaState vgaState;
+        sp--;
 
-        std::uint16_t pc;
-        std::uint16_t ir;
+        return stack[sp];
+    }
 
-        std::uint8_t dt;
-        std::uint8_t st;
-        std::uint8_t sp;
+    void CpuState::pushToStack(const std::uint16_t value)
+    {
+        stack[sp] = value;
+        sp++;
+    }
 
-        std::array<std::uint8_t, 16> v;
-        std::stack<std::uint16_t> stack;
+    bool CpuState::CLS(c8::Machine& machine)
+    {
+        machine.getVgaState().clear();
+        pc += 2;
 
-        std::uint8_t* getRegister(const std::uint8_t index)
-        {
-            if (index > 0xF) {
-                return nullptr;
-            }
+        return true;
+    }
 
-            return &v[index];
+    bool CpuState::RET()
+    {
+        if (sp == 0) {
+            return false;
         }
 
-        std::uint16_t popFromStack()
-        {
-            const std::uint16_t value =  stack.top();
+        const std::uint16_t addr = popFromStack();
 
-            stack.pop();
-            sp--;
+        pc = addr + 2;
 
-            return value;
-        }
+        return true;
+    }
 
-        void pushToStack(const std::uint16_t value)
-        {
-            sp++;
-            stack.push(value);
+    bool CpuState::JP_Addr(const std::uint16_t addr)
+    {
+        if (pc == addr) {
+            return false;
         }
 
-        std::uint8_t getCurrentKeyboardValue()
-        {
-            for (const auto& [key, value] : c8::ui::valueByKey) { 
-                if (sf::Keyboard::isKeyPressed(key)) {
-                    return value;
-                }
-            }
+        pc = addr;
 
-            return 0xFF;
-        }
-
-        bool CLS()
-        {
-            vgaState.clear();
-            pc += 2;
+        return true;
+    }
 
-            return true;
+    bool CpuState::CALL_Addr(const std::uint16_t addr)
+    {
+        if (sp == stack.size()) {
+            return false;
         }
 
-        bool RET()
-        {
-            const std::uint16_t addr = popFromStack();
+        pushToStack(pc);
+        pc = addr;
 
-            pc = addr + 2;
-
-            return true;
-        }
-
-        bool JP_Addr(const std::uint16_t addr)
-        {
-            if (pc == addr) {
-                return false;
-            }
+        return true;
+    }
 
-            pc = addr;
+    bool CpuState::SE_Vx_Byte(const std::uint8_t x, const std::uint8_t value)
+    {
+        std::uint8_t* vx = getRegister(x);
 
-            return true;
+        if (vx == nullptr) {
+            return false;
         }
 
-        bool CALL_Addr(const std::uint16_t addr)
-        {
-            pushToStack(pc);
-            pc = addr;
-
-            return true;
+        if (*vx == value) {
+            pc += 2;
         }
 
-        bool SE_Vx_Byte(const std::uint8_t x, const std::uint8_t value)
-        {
-            std::uint8_t* vx = getRegister(x);
-
-            if (vx == nullptr) {
-                return false;
-            }
+        pc += 2;
 
-            if (*vx == value) {
-                pc += 2;
-            }
+        return true;
+    }
 
-            pc += 2;
+    bool CpuState::SNE_Vx_Byte(const std::uint8_t x, const std::uint8_t value)
+    {
+        std::uint8_t* vx = getRegister(x);
 
-            return true;
+        if (vx == nullptr) {
+            return false;
         }
 
-        bool SNE_Vx_Byte(const std::uint8_t x, const std::uint8_t value)
-        {
-            std::uint8_t* vx = getRegister(x);
-
-            if (vx == nullptr) {
-                return false;
-            }
-
-            if (*vx != value) {
-                pc += 2;
-            }
-
+        if (*vx != value) {
             pc += 2;
-
-            return true;
         }
 
+        pc += 2;
 
-        bool SE_Vx_Vy(const std::uint8_t x, const std::uint8_t y)
-        {
-            std::uint8_t* vx = getRegister(x);
-            std::uint8_t* vy = getRegister(y);
+        return true;
+    }
 
-            if (vx == nullptr || vy == nullptr) {
-                return false;
-            }
+    bool CpuState::SE_Vx_Vy(const std::uint8_t x, const std::uint8_t y)
+    {
+        std::uint8_t* vx = getRegister(x);
+        std::uint8_t* vy = getRegister(y);
 
-            if (*vx == *vy) {
-                pc += 2;
-            }
+        if (vx == nullptr || vy == nullptr) {
+            return false;
+        }
 
+        if (*vx == *vy) {
             pc += 2;
-
-            return true;
         }
 
-        bool LD_Vx_Byte(const std::uint8_t x, const std::uint8_t value)
-        {
-            std::uint8_t* vx = getRegister(x);
+        pc += 2;
 
-            if (vx == nullptr) {
-                return false;
-            }
+        return true;
+    }
 
-            *vx = value;
-            pc += 2;
+    bool CpuState::LD_Vx_Byte(const std::uint8_t x, const std::uint8_t value)
+    {
+        std::uint8_t* vx = getRegister(x);
 
-            return true;
+        if (vx == nullptr) {
+            return false;
         }
 
-        bool ADD_Vx_Byte(const std::uint8_t x, const std::uint8_t value)
-        {
-            std::uint8_t* vx = getRegister(x);
+        *vx = value;
+        pc += 2;
 
-            if (vx == nullptr) {
-                return false;
-            }
+        return true;
+    }
 
-            *vx += value;
-            pc += 2;
+    bool CpuState::ADD_Vx_Byte(const std::uint8_t x, const std::uint8_t value)
+    {
+        std::uint8_t* vx = getRegister(x);
 
-            return true;
+        if (vx == nullptr) {
+            return false;
         }
 
-        bool LD_Vx_Vy(const std::uint8_t x, const std::uint8_t y)
-        {
-            std::uint8_t* vx = getRegister(x);
-            std::uint8_t* vy = getRegister(y);
+        *vx += value;
+        pc += 2;
 
-            if (vx == nullptr || vy == nullptr) {
-                return false;
-            }
+        return true;
+    }
 
-            *vx = *vy;
-            pc += 2;
+    bool CpuState::LD_Vx_Vy(const std::uint8_t x, const std::uint8_t y)
+    {
+        std::uint8_t* vx = getRegister(x);
+        std::uint8_t* vy = getRegister(y);
 
-            return true;
+        if (vx == nullptr || vy == nullptr) {
+            return false;
         }
 
-        bool OR_Vx_Vy(const std::uint8_t x, const std::uint8_t y)
-        {
-            std::uint8_t* vx = getRegister(x);
-            std::uint8_t* vy = getRegister(y);
+        *vx = *vy;
+        pc += 2;
 
-            if (vx == nullptr || vy == nullptr) {
-                return false;
-            }
+        return true;
+    }
 
-            *vx = *vx | *vy;
-            pc += 2;
+    bool CpuState::OR_Vx_Vy(const std::uint8_t x, const std::uint8_t y)
+    {
+        std::uint8_t* vx = getRegister(x);
+        std::uint8_t* vy = getRegister(y);
 
-            return true;
+        if (vx == nullptr || vy == nullptr) {
+            return false;
         }
 
-        bool AND_Vx_Vy(const std::uint8_t x, const std::uint8_t y)
-        {
-            std::uint8_t* vx = getRegister(x);
-            std::uint8_t* vy = getRegister(y);
+        *vx = *vx | *vy;
+        pc += 2;
 
-            if (vx == nullptr || vy == nullptr) {
-                return false;
-            }
+        return true;
+    }
 
-            *vx = *vx & *vy;
-            pc += 2;
+    bool CpuState::AND_Vx_Vy(const std::uint8_t x, const std::uint8_t y)
+    {
+        std::uint8_t* vx = getRegister(x);
+        std::uint8_t* vy = getRegister(y);
 
-            return true;
+        if (vx == nullptr || vy == nullptr) {
+            return false;
         }
 
-        bool XOR_Vx_Vy(const std::uint8_t x, const std::uint8_t y)
-        {
-            std::uint8_t* vx = getRegister(x);
-            std::uint8_t* vy = getRegister(y);
+        *vx = *vx & *vy;
+        pc += 2;
 
-            if (vx == nullptr || vy == nullptr) {
-                return false;
-            }
+        return true;
+    }
 
-            *vx = *vx ^ *vy;
-            pc += 2;
+    bool CpuState::XOR_Vx_Vy(const std::uint8_t x, const std::uint8_t y)
+    {
+        std::uint8_t* vx = getRegister(x);
+        std::uint8_t* vy = getRegister(y);
 
-            return true;
+        if (vx == nullptr || vy == nullptr) {
+            return false;
         }
 
-        bool ADD_Vx_Vy(const std::uint8_t x, const std::uint8_t y)
-        {
-            std::uint8_t* vx = getRegister(x);
-            std::uint8_t* vy = getRegister(y);
-
-            if (vx == nullptr || vy == nullptr) {
-                return false;
-            }
+        *vx = *vx ^ *vy;
+        pc += 2;
 
-            const auto result = (int)*vx + (int)*vy;
-
-            v[15] = result > 255 ? 1 : 0;
-            *vx = static_cast<std::uint8_t>(result);
+        return true;
+    }
 
-            pc += 2;
+    bool CpuState::ADD_Vx_Vy(const std::uint8_t x, const std::uint8_t y)
+    {
+        std::uint8_t* vx = getRegister(x);
+        std::uint8_t* vy = getRegister(y);
 
-            return true;
+        if (vx == nullptr || vy == nullptr) {
+            return false;
         }
 
-        bool SUB_Vx_Vy(const std::uint8_t x, const std::uint8_t y)
-        {
-            std::uint8_t* vx = getRegister(x);
-            std::uint8_t* vy = getRegister(y);
+        const auto result = (int)*vx + (int)*vy;
 
-            if (vx == nullptr || vy == nullptr) {
-                return false;
-            }
+        v[15] = result > 255 ? 1 : 0;
+        *vx = static_cast<std::uint8_t>(result);
 
-            const auto result = *vx - *vy;
+        pc += 2;
 
-            v[15] = *vx > *vy ? 1 : 0;
+        return true;
+    }
 
-            *vx = static_cast<std::uint8_t>(result);
-            pc += 2;
+    bool CpuState::SUB_Vx_Vy(const std::uint8_t x, const std::uint8_t y)
+    {
+        std::uint8_t* vx = getRegister(x);
+        std::uint8_t* vy = getRegister(y);
 
-            return true;
+        if (vx == nullptr || vy == nullptr) {
+            return false;
         }
 
-        bool SHR_Vx_Vy(const std::uint8_t x, const std::uint8_t y)
-        {
-            std::uint8_t* vx = getRegister(x);
-            std::uint8_t* vy = getRegister(y);
+        const auto result = *vx - *vy;
 
-            if (vx == nullptr || vy == nullptr) {
-                return false;
-            }
+        v[15] = *vx > *vy ? 1 : 0;
 
-            if (c8::quirks::shiftWithVy) {
-                *vx = *vy;
-            }
+        *vx = static_cast<std::uint8_t>(result);
+        pc += 2;
 
-            const auto bit = *vx & 0b0000'0001;
+        return true;
+    }
 
-            v[15] = bit >= 1 ? 1 : 0;
+    bool CpuState::SHR_Vx_Vy(const std::uint8_t x, const std::uint8_t y)
+    {
+        std::uint8_t* vx = getRegister(x);
+        std::uint8_t* vy = getRegister(y);
 
-            *vx = *vx >> 1;
-            pc += 2;
+        if (vx == nullptr || vy == nullptr) {
+            return false;
+        }
 
-            return true;
+        if (c8::quirks::shiftWithVy) {
+            *vx = *vy;
         }
 
-        bool SUBN_Vx_Vy(const std::uint8_t x, const std::uint8_t y)
-        {
-            std::uint8_t* vx = getRegister(x);
-            std::uint8_t* vy = getRegister(y);
+        const auto bit = *vx & 0b0000'0001;
 
-            if (vx == nullptr || vy == nullptr) {
-                return false;
-            }
+        v[15] = bit >= 1 ? 1 : 0;
 
-            const auto result = *vy - *vx;
+        *vx = *vx >> 1;
+        pc += 2;
 
-            v[15] = *vy > *vx ? 1 : 0;
+        return true;
+    }
 
-            *vx = static_cast<std::uint8_t>(result);   
-            pc += 2;
+    bool CpuState::SUBN_Vx_Vy(const std::uint8_t x, const std::uint8_t y)
+    {
+        std::uint8_t* vx = getRegister(x);
+        std::uint8_t* vy = getRegister(y);
 
-            return true;
+        if (vx == nullptr || vy == nullptr) {
+            return false;
         }
 
-        bool SHL_Vx_Vy(const std::uint8_t x, const std::uint8_t y)
-        {
-            std::uint8_t* vx = getRegister(x);
-            std::uint8_t* vy = getRegister(y);
-
-            if (vx == nullptr || vy == nullptr) {
-                return false;
-            }
+        const auto result = *vy - *vx;
 
-            if (c8::quirks::shiftWithVy) {
-                *vx = *vy;
-            }
+        v[15] = *vy > *vx ? 1 : 0;
 
-            const auto bit = *vx & 0b1000'0000;
+        *vx = static_cast<std::uint8_t>(result);   
+        pc += 2;
 
-            v[15] = bit >= 1 ? 1 : 0;
+        return true;
+    }
 
-            *vx = *vx << 1;
-            pc += 2;
+    bool CpuState::SHL_Vx_Vy(const std::uint8_t x, const std::uint8_t y)
+    {
+        std::uint8_t* vx = getRegister(x);
+        std::uint8_t* vy = getRegister(y);
 
-            return true;
+        if (vx == nullptr || vy == nullptr) {
+            return false;
         }
 
-        bool SNE_Vx_Vy(const std::uint8_t x, const std::uint8_t y)
-        {
-            std::uint8_t* vx = getRegister(x);
-            std::uint8_t* vy = getRegister(y);
-
-            if (vx == nullptr || vy == nullptr) {
-                return false;
-            }
-
-            if (*vx != *vy) {
-                pc += 2;
-            }
-
-            pc += 2;
-
-            return true;
+        if (c8::quirks::shiftWithVy) {
+            *vx = *vy;
         }
 
-        bool LD_I_Addr(const std::uint16_t value) 
-        {
-            ir = value;
-            pc += 2;
+        const auto bit = *vx & 0b1000'0000;
 
-            return true;
-        }
-
-        bool JP_V0_Addr(const std::uint16_t value)
-        {
-            pc = value + v[0];
+        v[15] = bit >= 1 ? 1 : 0;
 
-            return true;
-        }
+        *vx = *vx << 1;
+        pc += 2;
 
-        bool RND_Vx_Byte(const std::uint8_t x, const std::uint16_t value)
-        {
-            std::uint8_t* vx = getRegister(x);
+        return true;
+    }
 
-            if (vx == nullptr) {
-                return false;
-            }
+    bool CpuState::SNE_Vx_Vy(const std::uint8_t x, const std::uint8_t y)
+    {
+        std::uint8_t* vx = getRegister(x);
+        std::uint8_t* vy = getRegister(y);
 
-            const std::uint8_t randomValue = distribution(generator);
+        if (vx == nullptr || vy == nullptr) {
+            return false;
+        }
 
-            *vx = randomValue & value;
+        if (*vx != *vy) {
             pc += 2;
-
-            return true;
         }
 
-        bool DRW_Vx_Vy_Nibble(const std::uint8_t x, const std::uint8_t y, const std::uint8_t n)
-        {
-            std::uint8_t* vx = getRegister(x);
-            std::uint8_t* vy = getRegister(y);
-
-            if (vx == nullptr || vy == nullptr || n == 0) {
-                return false;
-            }
-
-            bool didErase = false;
-
-            for (int i = 0; i < n; i++) {
-                const std::uint8_t byte = c8::mem::readByte(ir + i);
+        pc += 2;
 
-                didErase = vgaState.drawByte(*vx, *vy + i, byte) || didErase;
-            }
-
-            v[15] = didErase ? 1 : 0;
-            pc += 2;
-
-            return true;
-        }
+        return true;
+    }
 
-        bool SKP_Vx(const std::uint8_t x) 
-        {
-            std::uint8_t* vx = getRegister(x);
+    bool CpuState::LD_I_Addr(const std::uint16_t value)
+    {
+        ir = value;
+        pc += 2;
 
-            if (vx == nullptr) {
-                return false;
-            }
+        return true;
+    }
 
-            const std::uint8_t input = getCurrentKeyboardValue();
+    bool CpuState::JP_V0_Addr(const std::uint16_t value)
+    {
+        pc = value + v[0];
 
-            if (*vx == input) {
-                pc += 2;
-            }
+        return true;
+    }
 
-            pc += 2;
+    bool CpuState::RND_Vx_Byte(c8::Machine& machine, const std::uint8_t x, const std::uint16_t value)
+    {
+        std::uint8_t* vx = getRegister(x);
 
-            return true;
+        if (vx == nullptr) {
+            return false;
         }
 
-        bool SKNP_Vx(const std::uint8_t x)
-        {
-            std::uint8_t* vx = getRegister(x);
-
-            if (vx == nullptr) {
-                return false;
-            }
+        const std::uint8_t randomValue = machine.nextRandom();
 
-            const std::uint8_t input = getCurrentKeyboardValue();
+        *vx = randomValue & value;
+        pc += 2;
 
-            if (*vx != input) {
-                pc += 2;
-            }
+        return true;
+    }
 
-            pc += 2;
+    bool CpuState::DRW_Vx_Vy_Nibble(c8::Machine& machine, const std::uint8_t x, const std::uint8_t y, const std::uint8_t n)
+    {
+        std::uint8_t* vx = getRegister(x);
+        std::uint8_t* vy = getRegister(y);
 
-            return true;
+        if (vx == nullptr || vy == nullptr || n == 0) {
+            return false;
         }
 
-        bool LD_Vx_DT(const std::uint8_t x)
-        {
-            std::uint8_t* vx = getRegister(x);
+        bool didErase = false;
 
-            if (vx == nullptr) {
-                return false;
-            }
-
-            *vx = dt;
-            pc += 2;
+        for (int i = 0; i < n; i++) {
+            const std::uint8_t byte = machine.getMemory().readByte(ir + i);
 
-            return true;
+            didErase = machine.getVgaState().drawByte(*vx, *vy + i, byte) || didErase;
         }
 
-        bool LD_Vx_K(const std::uint8_t x)
-        {
-            std::uint8_t* vx = getRegister(x);
+        v[15] = didErase ? 1 : 0;
+        pc += 2;
 
-            if (vx == nullptr) {
-                return false;
-            }
-
-            waitingForKeyboard = true;
-
-            if (keyboardPressedValue == 0xFF) {
-                return false;
-            }
-
-            *vx = keyboardPressedValue;
-            pc += 2;
+        return true;
+    }
 
-            keyboardPressedValue = 0xFF;
-            waitingForKeyboard = false;
+    bool CpuState::SKP_Vx(const c8::Machine& machine, const std::uint8_t x)
+    {
+        std::uint8_t* vx = getRegister(x);
 
-            return true;
+        if (vx == nullptr) {
+            return false;
         }
 
-        bool LD_DT_Vx(const std::uint8_t x)
-        {
-            std::uint8_t* vx = getRegister(x);
-
-            if (vx == nullptr) {
-                return false;
-            }
-
-            dt = *vx;
+        if (machine.isKeyDown(*vx)) {
             pc += 2;
-
-            return true;
         }
 
-        bool LD_ST_Vx(const std::uint8_t x)
-        {
-            std::uint8_t* vx = getRegister(x);
+        pc += 2;
 
-            if (vx == nullptr) {
-                return false;
-            }
+        return true;
+    }
 
-            st = *vx;
-            pc += 2;
+    bool CpuState::SKNP_Vx(const c8::Machine& machine, const std::uint8_t x)
+    {
+        std::uint8_t* vx = getRegister(x);
 
-            return true;
+        if (vx == nullptr) {
+            return false;
         }
 
-        bool ADD_I_Vx(const std::uint8_t x)
-        {
-            std::uint8_t* vx = getRegister(x);
-
-            if (vx == nullptr) {
-                return false;
-            }
-
-            ir = ir + *vx;
+        if (!machine.isKeyDown(*vx)) {
             pc += 2;
-
-            return true;
         }
 
-        bool LD_F_Vx(const std::uint8_t x)
-        {
-            std::uint8_t* vx = getRegister(x);
+        pc += 2;
 
-            if (vx == nullptr) {
-                return false;
-            }
+        return true;
+    }
 
-            ir = c8::mem::getFontSpriteAddress(*vx);
-            pc += 2;
+    bool CpuState::LD_Vx_DT(const std::uint8_t x)
+    {
+        std::uint8_t* vx = getRegister(x);
 
-            return true;
+        if (vx == nullptr) {
+            return false;
         }
 
-        bool LD_B_Vx(const std::uint8_t x)
-        {
-            std::uint8_t* vx = getRegister(x);
-
-            if (vx == nullptr) {
-                return false;
-            }
-
-            const std::uint8_t hundreds = (*vx / 100) % 10;
-            const std::uint8_t tens = (*vx / 10) % 10;
-            const std::uint8_t ones = *vx % 10;
+        *vx = dt;
+        pc += 2;
 
-            c8::mem::writeByte(ir, hundreds);
-            c8::mem::writeByte(ir + 1, tens);
-            c8::mem::writeByte(ir + 2, ones);
+        return true;
+    }
 
-            pc += 2;
+    bool CpuState::LD_Vx_K(c8::Machine& machine, const std::uint8_t x)
+    {
+        std::uint8_t* vx = getRegister(x);
 
-            return true;
+        if (vx == nullptr) {
+            return false;
         }
 
-        bool LD_IAddr_Vx(const std::uint8_t x)
-        {
-            for (std::uint8_t i = 0; i <= x; i++) {
-                std::uint8_t* vx = getRegister(i);
-
-                c8::mem::writeByte(ir + i, *vx);
-            }
-
-            if (c8::quirks::memoryIncrementI) {
-                ir += x + 1;
-            }
-
-            pc += 2;
+        std::uint8_t key;
 
-            return true;
+        if (!machine.waitForKey(key)) {
+            return false;
         }
 
-        bool LD_Vx_IAddr(const std::uint8_t x)
-        {
-            for (std::uint8_t i = 0; i <= x; i++) {
-                std::uint8_t* vx = getRegister(i);
-
-                *vx = c8::mem::readByte(ir + i);
-            }
+        *vx = key;
+        pc += 2;
 
-            if (c8::quirks::memoryIncrementI) {
-                ir += x + 1;
-            }
+        return true;
+    }
 
-            pc += 2;
+    bool CpuState::LD_DT_Vx(const std::uint8_t x)
+    {
+        std::uint8_t* vx = getRegister(x);
 
-            return true;
+        if (vx == nullptr) {
+            return false;
         }
-    };
-
-    constexpr int maxCpuStates = 1000;
-
-    CpuState cpuStates[maxCpuStates];
 
-    std::uint64_t totalCpuCycles = 0;
-    int currentCpuStateDisplayIndex = 0;
-    int currentCpuStateIndex = 0;
-    int headCpuStateIndex = 0;
+        dt = *vx;
+        pc += 2;
 
-    CpuState& getCurrentCpuState()
-    {
-        return cpuStates[currentCpuStateIndex];
+        return true;
     }
 
-    void initialize()
+    bool CpuState::LD_ST_Vx(const std::uint8_t x)
     {
-        paused = false;
-        doAdvanceOneClockCycle = false;
-        waitingForKeyboard = false;
-        keyboardPressedValue = 0xFF;
+        std::uint8_t* vx = getRegister(x);
 
-        reset();
-    }
+        if (vx == nullptr) {
+            return false;
+        }
 
-    void setCpuFrequency(int hz)
-    {
-        cpuHertz = hz;
-    }
+        st = *vx;
+        pc += 2;
 
-    void setFps(int fps)
-    {
-        hostFps = fps;
+        return true;
     }
 
-    void reset()
+    bool CpuState::ADD_I_Vx(const std::uint8_t x)
     {
-        currentCpuStateIndex = 0;
-        headCpuStateIndex = 0;
-        totalCpuCycles = 0;
+        std::uint8_t* vx = getRegister(x);
 
-        CpuState& currentCpuState = getCurrentCpuState();
+        if (vx == nullptr) {
+            return false;
+        }
 
-        currentCpuState.pc = 0x200;
-        currentCpuState.vgaState.clear();
+        ir = ir + *vx;
+        pc += 2;
 
-        c8::mem::reset();
+        return true;
     }
 
-    void keyboardKeyPressed(std::uint8_t value)
+    bool CpuState::LD_F_Vx(const std::uint8_t x)
     {
-        if (!waitingForKeyboard) {
-            return;
+        std::uint8_t* vx = getRegister(x);
+
+        if (vx == nullptr) {
+            return false;
         }
 
-        keyboardPressedValue = value;
-    }
+        ir = c8::mem::getFontSpriteAddress(*vx);
+        pc += 2;
 
-    std::uint16_t getProgramCounter()
-    {
-        return getCurrentCpuState().pc;
+        return true;
     }
 
-    void togglePaused()
+    bool CpuState::LD_B_Vx(c8::Machine& machine, const std::uint8_t x)
     {
-        paused = !paused;
-    }
+        std::uint8_t* vx = getRegister(x);
 
-    void advanceOneClockCycle()
-    {
-        if (!paused) {
-            return;
+        if (vx == nullptr) {
+            return false;
         }
 
-        doAdvanceOneClockCycle = true;
-    }
+        const std::uint8_t hundreds = (*vx / 100) % 10;
+        const std::uint8_t tens = (*vx / 10) % 10;
+        const std::uint8_t ones = *vx % 10;
 
-    void backOneClockCylce()
-    {
-        if (!paused) {
-            return;
-        }
+        c8::mem::Memory& memory = machine.getMemory();
 
-        if (currentCpuStateIndex != headCpuStateIndex + 1) {
-            currentCpuStateIndex = currentCpuStateIndex == 0 ? maxCpuStates - 1 : currentCpuStateIndex - 1;
-            currentCpuStateDisplayIndex--;
-        }
+        memory.writeByte(ir, hundreds);
+        memory.writeByte(ir + 1, tens);
+        memory.writeByte(ir + 2, ones);
 
-        if (totalCpuCycles < maxCpuStates && currentCpuStateIndex > headCpuStateIndex) {
-            currentCpuStateIndex = 0;
-            currentCpuStateDisplayIndex = 0;
-        }
+        pc += 2;
+
+        return true;
     }
 
-    void renderCpuInfo(sf::RenderTexture& texture)
+    bool CpuState::LD_IAddr_Vx(c8::Machine& machine, const std::uint8_t x)
     {
-        std::stringstream ss;
+        c8::mem::Memory& memory = machine.getMemory();
 
-        const CpuState& currentCpuState = getCurrentCpuState();
+        for (std::uint8_t i = 0; i <= x; i++) {
+            std::uint8_t* vx = getRegister(i);
 
-        ss << "PC = " << c8::ui::Hex{currentCpuState.pc} << "\t" << "I = " << c8::ui::Hex{currentCpuState.ir} << "\n\n";
-        ss << "DT = " << c8::ui::Hex{currentCpuState.dt} << "\t" << "ST = " << c8::ui::Hex{currentCpuState.st} << "\n\n";
-        ss << "V0 = " << c8::ui::Hex{currentCpuState.v[0x0]} << "\tV8 = " << c8::ui::Hex{currentCpuState.v[0x8]} << "\n";
-        ss << "V1 = " << c8::ui::Hex{currentCpuState.v[0x1]} << "\tV9 = " << c8::ui::Hex{currentCpuState.v[0x9]} << "\n";
-        ss << "V2 = " << c8::ui::Hex{currentCpuState.v[0x2]} << "\tVA = " << c8::ui::Hex{currentCpuState.v[0xA]} << "\n";
-        ss << "V3 = " << c8::ui::Hex{currentCpuState.v[0x3]} << "\tVB = " << c8::ui::Hex{currentCpuState.v[0xB]} << "\n";
-        ss << "V4 = " << c8::ui::Hex{currentCpuState.v[0x4]} << "\tVC = " << c8::ui::Hex{currentCpuState.v[0xC]} << "\n";
-        ss << "V5 = " << c8::ui::Hex{currentCpuState.v[0x5]} << "\tVD = " << c8::ui::Hex{currentCpuState.v[0xD]} << "\n";
-        ss << "V6 = " << c8::ui::Hex{currentCpuState.v[0x6]} << "\tVE = " << c8::ui::Hex{currentCpuState.v[0xE]} << "\n";
-        ss << "V7 = " << c8::ui::Hex{currentCpuState.v[0x7]} << "\tVF = " << c8::ui::Hex{currentCpuState.v[0xF]} << "\n\n";
-        ss << "Emulator State = " << (paused ? "PAUSED" : "RUNNING") << "\n";
-        ss << "Current CPU State = " << currentCpuStateDisplayIndex << "/" << maxCpuStates << "\n";
-        ss << "CPU Frequency = " << cpuHertz << "Hz" << "\n";
-        ss << "Render Speed = " << hostFps << "FPS" << "\n\n";
-        ss << "Controls:\n";
-        ss << "P = start/pause emulator" << "\n";
-        ss << "Left/Right = forward/backward 1 CPU cycle";
+            memory.writeByte(ir + i, *vx);
+        }
 
-        c8::ui::drawText(texture, 0, 0, ss);
-    }
+        if (c8::quirks::memoryIncrementI) {
+            ir += x + 1;
+        }
 
-    void renderVga(sf::RenderTexture& texture)
-    {
-        getCurrentCpuState().vgaState.render(texture);
+        pc += 2;
+
+        return true;
     }
 
-    void decrementTimers()
+    bool CpuState::LD_Vx_IAddr(c8::Machine& machine, const std::uint8_t x)
     {
-        if (paused && !doAdvanceOneClockCycle) {
-            return;
-        }
+        const c8::mem::Memory& memory = machine.getMemory();
 
-        CpuState& currentCpuState = getCurrentCpuState();
+        for (std::uint8_t i = 0; i <= x; i++) {
+            std::uint8_t* vx = getRegister(i);
 
-        if (currentCpuState.dt > 0) {
-            currentCpuState.dt--;
+            *vx = memory.readByte(ir + i);
         }
 
-        if (currentCpuState.st > 0) {
-            currentCpuState.st--;
+        if (c8::quirks::memoryIncrementI) {
+            ir += x + 1;
         }
+
+        pc += 2;
+
+        return true;
     }
 
-    bool processOpcode(const std::uint16_t word)
+    bool CpuState::execute(c8::Machine& machine, const std::uint16_t word)
     {
         const c8::opcodes::Opcode opcode = c8::opcodes::decode(word);
 
@@ -779,122 +600,139 @@ namespace c8::cpu
         const std::uint8_t kk = c8::opcodes::getOpcodeKK(word);
         const std::uint16_t nnn = c8::opcodes::getOpcodeNNN(word);
 
-        CpuState& currentCpuState = getCurrentCpuState();
-
         switch (opcode) {
         case c8::opcodes::Opcode::CLS:
-            return currentCpuState.CLS();
+            return CLS(machine);
         case c8::opcodes::Opcode::RET:
-            return currentCpuState.RET();
+            return RET();
         case c8::opcodes::Opcode::JP_Addr:
-            return currentCpuState.JP_Addr(nnn);
+            return JP_Addr(nnn);
         case c8::opcodes::Opcode::CALL_Addr:
-            return currentCpuState.CALL_Addr(nnn);
+            return CALL_Addr(nnn);
         case c8::opcodes::Opcode::SE_Vx_Byte:
-            return currentCpuState.SE_Vx_Byte(x, kk);
+            return SE_Vx_Byte(x, kk);
         case c8::opcodes::Opcode::SNE_Vx_Byte:
-            return currentCpuState.SNE_Vx_Byte(x, kk);
+            return SNE_Vx_Byte(x, kk);
         case c8::opcodes::Opcode::SE_Vx_Vy:
-            return currentCpuState.SE_Vx_Vy(x, y);
+            return SE_Vx_Vy(x, y);
         case c8::opcodes::Opcode::LD_Vx_Byte:
-            return currentCpuState.LD_Vx_Byte(x, kk);
+            return LD_Vx_Byte(x, kk);
         case c8::opcodes::Opcode::ADD_Vx_Byte:
-            return currentCpuState.ADD_Vx_Byte(x, kk);
+            return ADD_Vx_Byte(x, kk);
         case c8::opcodes::Opcode::LD_Vx_Vy:
-            return currentCpuState.LD_Vx_Vy(x, y);
+            return LD_Vx_Vy(x, y);
         case c8::opcodes::Opcode::OR_Vx_Vy:
-            return currentCpuState.OR_Vx_Vy(x, y);
+            return OR_Vx_Vy(x, y);
         case c8::opcodes::Opcode::AND_Vx_Vy:
-            return currentCpuState.AND_Vx_Vy(x, y);
+            return AND_Vx_Vy(x, y);
         case c8::opcodes::Opcode::XOR_Vx_Vy:
-            return currentCpuState.XOR_Vx_Vy(x, y);
+            return XOR_Vx_Vy(x, y);
         case c8::opcodes::Opcode::ADD_Vx_Vy:
-            return currentCpuState.ADD_Vx_Vy(x, y);
+            return ADD_Vx_Vy(x, y);
         case c8::opcodes::Opcode::SUB_Vx_Vy:
-            return currentCpuState.SUB_Vx_Vy(x, y);
+            return SUB_Vx_Vy(x, y);
         case c8::opcodes::Opcode::SHR_Vx_Vy:
-            return currentCpuState.SHR_Vx_Vy(x, y);
+            return SHR_Vx_Vy(x, y);
         case c8::opcodes::Opcode::SUBN_Vx_Vy:
-            return currentCpuState.SUBN_Vx_Vy(x, y);
+            return SUBN_Vx_Vy(x, y);
         case c8::opcodes::Opcode::SHL_Vx_Vy:
-            return currentCpuState.SHL_Vx_Vy(x, y);
+            return SHL_Vx_Vy(x, y);
         case c8::opcodes::Opcode::SNE_Vx_Vy:
-            return currentCpuState.SNE_Vx_Vy(x, y);
+            return SNE_Vx_Vy(x, y);
         case c8::opcodes::Opcode::LD_I_Addr:
-            return currentCpuState.LD_I_Addr(nnn);
+            return LD_I_Addr(nnn);
         case c8::opcodes::Opcode::JP_V0_Addr:
-            return currentCpuState.JP_V0_Addr(nnn);
+            return JP_V0_Addr(nnn);
         case c8::opcodes::Opcode::RND_Vx_Byte:
-            return currentCpuState.RND_Vx_Byte(x, kk);
+            return RND_Vx_Byte(machine, x, kk);
         case c8::opcodes::Opcode::DRW_Vx_Vy_Nibble:
-            return currentCpuState.DRW_Vx_Vy_Nibble(x, y, z);
+            return DRW_Vx_Vy_Nibble(machine, x, y, z);
         case c8::opcodes::Opcode::SKP_Vx:
-            return currentCpuState.SKP_Vx(x);
+            return SKP_Vx(machine, x);
         case c8::opcodes::Opcode::SKNP_Vx:
-            return currentCpuState.SKNP_Vx(x);
+            return SKNP_Vx(machine, x);
         case c8::opcodes::Opcode::LD_Vx_DT:
-            return currentCpuState.LD_Vx_DT(x);
+            return LD_Vx_DT(x);
         case c8::opcodes::Opcode::LD_Vx_K:
-            return currentCpuState.LD_Vx_K(x);
+            return LD_Vx_K(machine, x);
         case c8::opcodes::Opcode::LD_DT_Vx:
-            return currentCpuState.LD_DT_Vx(x);
+            return LD_DT_Vx(x);
         case c8::opcodes::Opcode::LD_ST_Vx:
-            return currentCpuState.LD_ST_Vx(x);
+            return LD_ST_Vx(x);
         case c8::opcodes::Opcode::ADD_I_Vx:
-            return currentCpuState.ADD_I_Vx(x);
+            return ADD_I_Vx(x);
         case c8::opcodes::Opcode::LD_F_Vx:
-            return currentCpuState.LD_F_Vx(x);
+            return LD_F_Vx(x);
         case c8::opcodes::Opcode::LD_B_Vx:
-            return currentCpuState.LD_B_Vx(x);
+            return LD_B_Vx(machine, x);
         case c8::opcodes::Opcode::LD_IAddr_Vx:
-            return currentCpuState.LD_IAddr_Vx(x);
+            return LD_IAddr_Vx(machine, x);
         case c8::opcodes::Opcode::LD_Vx_IAddr:
-            return currentCpuState.LD_Vx_IAddr(x);
+            return LD_Vx_IAddr(machine, x);
         case c8::opcodes::Opcode::Invalid:
         default:
+            machine.reportInvalidOpcode(pc);
             return false;
         }
     }
 
-    void executeClockCycle()
+    void initialize()
     {
-        if (paused && !doAdvanceOneClockCycle) {
-            return;
-        }
+        c8::defaultMachine().initialize();
+    }
 
-        doAdvanceOneClockCycle = false;
-        currentCpuStateDisplayIndex = currentCpuStateDisplayIndex == maxCpuStates ? maxCpuStates : currentCpuStateDisplayIndex + 1;
+    void setCpuFrequency(int hz)
+    {
+        c8::defaultMachine().setCpuFrequency(hz);
+    }
 
-        // If the currentCpuStateIndex != headCpuStateIndex then we are currently
-        // in a past cpu cycle, so to advance by 1 clock cycle, just increment
-        // currentCpuStateIndex until it equals headCpuStateIndex
-        if (currentCpuStateIndex != headCpuStateIndex) {
-            currentCpuStateIndex = currentCpuStateIndex == maxCpuStates - 1 ? 0 : currentCpuStateIndex + 1;
+    void reset()
+    {
+        c8::defaultMachine().reset();
+    }
 
-            return;
-        }
+    void keyboardKeyPressed(std::uint8_t value)
+    {
+        c8::defaultMachine().keyboardKeyPressed(value);
+    }
 
-        CpuState& currentCpuState = getCurrentCpuState();
+    std::uint16_t getProgramCounter()
+    {
+        return c8::defaultMachine().getCpuState().pc;
+    }
 
-        const std::uint16_t opcode = c8::mem::readWord(currentCpuState.pc);
+    void togglePaused()
+    {
+        c8::defaultMachine().togglePaused();
+    }
 
-        if (opcode == 0x0){
-            return;
-        }
+    void advanceOneClockCycle()
+    {
+        c8::defaultMachine().advanceOneClockCycle();
+    }
 
-        totalCpuCycles++;
-        headCpuStateIndex = headCpuStateIndex == maxCpuStates - 1 ? 0 : headCpuStateIndex + 1;
-        currentCpuStateIndex = headCpuStateIndex;
+    void backOneClockCylce()
+    {
+        c8::defaultMachine().backOneClockCycle();
+    }
 
-        cpuStates[headCpuStateIndex] = currentCpuState;
+    void processCommand(const Command& command)
+    {
+        c8::defaultMachine().processCommand(command);
+    }
 
-        const bool didUpdate = processOpcode(opcode);
+    void takeSnapshot(Snapshot& snapshot)
+    {
+        c8::defaultMachine().takeSnapshot(snapshot);
+    }
 
-        // If executing the next cpu instruction didn't result in any
-        // changes to the cpu state, we do not need to keep this one in our history.
-        if (!didUpdate) {
-            headCpuStateIndex = headCpuStateIndex == 0 ? maxCpuStates - 1 : headCpuStateIndex - 1;
-            currentCpuStateIndex = headCpuStateIndex;
-        }
+    std::uint8_t* getRegister(const std::uint8_t index)
+    {
+        return c8::defaultMachine().getCpuState().getRegister(index);
+    }
+
+    void executeClockCycle()
+    {
+        c8::defaultMachine().executeClockCycle();
     }
 }
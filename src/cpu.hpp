@@ -22,26 +22,218 @@
 #include <bitset>
 #include <iostream>
 #include <random>
-#include <stack>
 #include <ratio>
 #include <sstream>
 #include <iomanip>
 #include <cstdint>
+#include <array>
 
-#include <SFML/Graphics.hpp>
-
+#include "allocations.hpp"
+#include "counters.hpp"
 #include "memory.hpp"
+#include "perf.hpp"
+#include "phases.hpp"
 #include "vga.hpp"
 #include "quirks.hpp"
+#include "sync.hpp"
+
+namespace c8
+{
+    class Machine;
+}
 
 namespace c8::cpu
 {
+    // Number of past CPU states kept for rewinding
+    inline constexpr int maxCpuStates = 1000;
+
+    inline constexpr int maxStackDepth = 16;
+
+    /**
+     * Registers and stack of the CPU, and the handler for each instruction.
+     * Handlers that touch memory, the display, the keypad or the random
+     * number generator do so through the machine that is executing them.
+    */
+    class CpuState
+    {
+    public:
+        std::uint16_t pc;
+        std::uint16_t ir;
+
+        std::uint8_t dt;
+        std::uint8_t st;
+        std::uint8_t sp;
+
+        std::array<std::uint8_t, 16> v;
+        std::array<std::uint16_t, maxStackDepth> stack;
+
+        std::uint8_t* getRegister(const std::uint8_t index);
+
+        std::uint16_t popFromStack();
+
+        void pushToStack(const std::uint16_t value);
+
+        /**
+         * Decodes and executes word, returns false if the instruction was
+         * invalid or did not change any state
+        */
+        bool execute(c8::Machine& machine, const std::uint16_t word);
+
+        bool CLS(c8::Machine& machine);
+
+        bool RET();
+
+        bool JP_Addr(const std::uint16_t addr);
+
+        bool CALL_Addr(const std::uint16_t addr);
+
+        bool SE_Vx_Byte(const std::uint8_t x, const std::uint8_t value);
+
+        bool SNE_Vx_Byte(const std::uint8_t x, const std::uint8_t value);
+
+        bool SE_Vx_Vy(const std::uint8_t x, const std::uint8_t y);
+
+        bool LD_Vx_Byte(const std::uint8_t x, const std::uint8_t value);
+
+        bool ADD_Vx_Byte(const std::uint8_t x, const std::uint8_t value);
+
+        bool LD_Vx_Vy(const std::uint8_t x, const std::uint8_t y);
+
+        bool OR_Vx_Vy(const std::uint8_t x, const std::uint8_t y);
+
+        bool AND_Vx_Vy(const std::uint8_t x, const std::uint8_t y);
+
+        bool XOR_Vx_Vy(const std::uint8_t x, const std::uint8_t y);
+
+        bool ADD_Vx_Vy(const std::uint8_t x, const std::uint8_t y);
+
+        bool SUB_Vx_Vy(const std::uint8_t x, const std::uint8_t y);
+
+        bool SHR_Vx_Vy(const std::uint8_t x, const std::uint8_t y);
+
+        bool SUBN_Vx_Vy(const std::uint8_t x, const std::uint8_t y);
+
+        bool SHL_Vx_Vy(const std::uint8_t x, const std::uint8_t y);
+
+        bool SNE_Vx_Vy(const std::uint8_t x, const std::uint8_t y);
+
+        bool LD_I_Addr(const std::uint16_t value);
+
+        bool JP_V0_Addr(const std::uint16_t value);
+
+        bool RND_Vx_Byte(c8::Machine& machine, const std::uint8_t x, const std::uint16_t value);
+
+        bool DRW_Vx_Vy_Nibble(c8::Machine& machine, const std::uint8_t x, const std::uint8_t y, const std::uint8_t n);
+
+        bool SKP_Vx(const c8::Machine& machine, const std::uint8_t x);
+
+        bool SKNP_Vx(const c8::Machine& machine, const std::uint8_t x);
+
+        bool LD_Vx_DT(const std::uint8_t x);
+
+        bool LD_Vx_K(c8::Machine& machine, const std::uint8_t x);
+
+        bool LD_DT_Vx(const std::uint8_t x);
+
+        bool LD_ST_Vx(const std::uint8_t x);
+
+        bool ADD_I_Vx(const std::uint8_t x);
+
+        bool LD_F_Vx(const std::uint8_t x);
+
+        bool LD_B_Vx(c8::Machine& machine, const std::uint8_t x);
+
+        bool LD_IAddr_Vx(c8::Machine& machine, const std::uint8_t x);
+
+        bool LD_Vx_IAddr(c8::Machine& machine, const std::uint8_t x);
+    };
+
+    enum class CommandType
+    {
+        TogglePaused,
+        Step,
+        StepBack,
+        KeyDown,
+        KeyUp,
+        ToggleBreakpoint
+    };
+
+    /**
+     * Sent from the render thread to the emulation thread
+    */
+    struct Command
+    {
+        CommandType type;
+        std::uint8_t key;
+
+        // Only used by ToggleBreakpoint
+        std::uint16_t address = 0;
+    };
+
+    using CommandQueue = c8::sync::SpscQueue<Command, 256>;
+
+    /**
+     * Everything the render thread needs to draw one frame, published by the
+     * emulation thread once per emulated frame.
+    */
+    struct Snapshot
+    {
+        c8::vga::VgaState vgaState;
+
+        std::uint16_t pc;
+        std::uint16_t ir;
+
+        std::uint8_t dt;
+        std::uint8_t st;
+
+        std::array<std::uint8_t, 16> v;
+
+        bool paused;
+        int cpuStateDisplayIndex;
+        int cpuHertz;
+
+        std::chrono::microseconds frameIntervalP50;
+        std::chrono::microseconds frameIntervalP99;
+
+        std::int64_t backlogCycles;
+        std::uint64_t droppedCycles;
+        std::uint64_t caughtUpCycles;
+        std::uint64_t skippedFrames;
+
+        // All 0 unless config::countInstructions
+        std::uint64_t countedInstructions;
+        c8::counters::TopList topOpcodes;
+        c8::counters::TopList topAddresses;
+
+        // Emulation thread phases, the main loop fills this in
+        c8::phases::Summary emulationPhases;
+
+        // Hardware counters around the execute loop of the last frame that
+        // ran any cycles, nothing is available without --perf
+        c8::perf::Sample hostCounters;
+        int hostCountersCycles;
+
+        // Made by the emulation thread in its last frame, and in all execute
+        // loops so far. All 0 unless built with C8_TRACK_ALLOCATIONS.
+        c8::allocations::Counts emulationFrameAllocations;
+        c8::allocations::Counts executeAllocations;
+        std::uint64_t executedCycles;
+
+        c8::mem::Listing memoryListing;
+
+        // Only filled in when run with --heatmap
+        bool heatmapEnabled;
+        c8::mem::Heatmap heatmap;
+    };
+
+    /*
+     * The functions below operate on c8::defaultMachine()
+    */
+
     void initialize();
 
     void setCpuFrequency(int hz);
 
-    void setFps(int fps);
-
     void reset();
 
     void keyboardKeyPressed(std::uint8_t value);
@@ -54,15 +246,15 @@ namespace c8::cpu
 
     void backOneClockCylce();
 
-    void decrementTimers();
+    void processCommand(const Command& command);
 
-    void renderVga(sf::RenderTexture& texture);
-
-    void renderCpuInfo(sf::RenderTexture& texture);
+    void takeSnapshot(Snapshot& snapshot);
 
     std::uint8_t* getRegister(const std::uint8_t index);
 
+    /**
+     * Executes one instruction. DT and ST are also advanced here, so the
+     * timers only depend on how many cycles ran, not on the host frame rate.
+    */
     void executeClockCycle();
-
-    void decrementTimers();
 }
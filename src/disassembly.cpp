@@ -0,0 +1,112 @@
+/**
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "disassembly.hpp"
+
+#include <array>
+#include <algorithm>
+
+#include "memory.hpp"
+#include "machine.hpp"
+#include "opcodes.hpp"
+#include "format.hpp"
+
+namespace c8::disassembly
+{
+    Cache::Cache(const c8::mem::Memory& memory) :
+        memory(memory)
+    {
+    }
+
+    void Cache::invalidate(const std::uint16_t addr)
+    {
+        if (addr >= maxAddresses) {
+            return;
+        }
+
+        entries[addr].valid = false;
+
+        if (addr > 0) {
+            entries[addr - 1].valid = false;
+        }
+    }
+
+    void Cache::invalidateAll()
+    {
+        for (Entry& entry : entries) {
+            entry.valid = false;
+        }
+    }
+
+    std::string_view Cache::get(const std::uint16_t addr)
+    {
+        if (addr >= maxAddresses) {
+            return {};
+        }
+
+        Entry& entry = entries[addr];
+
+        if (!entry.valid) {
+            c8::format::Line line;
+
+            c8::opcodes::formatOpcodeName(memory.readWord(addr), line);
+
+            const std::string_view text = line.view();
+
+            entry.length = static_cast<std::uint8_t>(std::min(text.size(), maxEntryLength));
+            std::copy_n(text.data(), entry.length, entry.text);
+
+            entry.valid = true;
+        }
+
+        return std::string_view{entry.text, entry.length};
+    }
+
+    void Cache::exportAll(std::ostream& out)
+    {
+        c8::format::Line line;
+
+        for (int addr = 0; addr < maxAddresses; addr += 2) {
+            const auto address = static_cast<std::uint16_t>(addr);
+
+            line.clear()
+                .appendHex(address, false).append('\t')
+                .appendHex(memory.readWord(address), false).append('\t')
+                .append(get(address));
+
+            out << line.view() << '\n';
+        }
+    }
+
+    void invalidate(const std::uint16_t addr)
+    {
+        c8::defaultMachine().getDisassembly()->invalidate(addr);
+    }
+
+    void invalidateAll()
+    {
+        c8::defaultMachine().getDisassembly()->invalidateAll();
+    }
+
+    std::string_view get(const std::uint16_t addr)
+    {
+        return c8::defaultMachine().getDisassembly()->get(addr);
+    }
+
+    void exportAll(std::ostream& out)
+    {
+        c8::defaultMachine().getDisassembly()->exportAll(out);
+    }
+}
@@ -0,0 +1,86 @@
+/**
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string_view>
+#include <array>
+
+namespace c8::mem
+{
+    class Memory;
+}
+
+namespace c8::disassembly
+{
+    inline constexpr int maxAddresses = 4096;
+    inline constexpr std::size_t maxEntryLength = 24;
+
+    /**
+     * Mnemonics of the words in one machine's memory, decoded lazily and
+     * kept until the memory under them is written to.
+    */
+    class Cache
+    {
+    private:
+        struct Entry
+        {
+            char text[maxEntryLength];
+            std::uint8_t length;
+            bool valid;
+        };
+
+        const c8::mem::Memory& memory;
+
+        std::array<Entry, maxAddresses> entries{};
+
+    public:
+        explicit Cache(const c8::mem::Memory& memory);
+
+        /**
+         * Drops the cached text of every instruction that overlaps addr. Called
+         * by c8::mem::Memory whenever a byte of memory is written.
+        */
+        void invalidate(const std::uint16_t addr);
+
+        void invalidateAll();
+
+        /**
+         * Mnemonic of the word at addr, decoded on first use and cached until
+         * the memory under it is written to.
+        */
+        std::string_view get(const std::uint16_t addr);
+
+        /**
+         * Writes a listing of every even address in memory, one instruction
+         * per line.
+        */
+        void exportAll(std::ostream& out);
+    };
+
+    /*
+     * The functions below operate on the cache of c8::defaultMachine()
+    */
+
+    void invalidate(const std::uint16_t addr);
+
+    void invalidateAll();
+
+    std::string_view get(const std::uint16_t addr);
+
+    void exportAll(std::ostream& out);
+}
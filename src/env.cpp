@@ -0,0 +1,129 @@
+/**
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "env.hpp"
+
+#include <algorithm>
+#include <utility>
+
+#include "config.hpp"
+
+namespace c8::env
+{
+    std::vector<std::uint16_t> getDefaultActions()
+    {
+        std::vector<std::uint16_t> actions{0};
+
+        for (int key = 0; key <= 0xF; key++) {
+            actions.push_back(static_cast<std::uint16_t>(1 << key));
+        }
+
+        return actions;
+    }
+
+    Environment::Environment(
+        const std::uint8_t* rom,
+        const std::size_t romSize,
+        std::vector<std::uint16_t> actions,
+        const Options& options) :
+        machine(0, options.seed),
+        actions(actions.empty() ? getDefaultActions() : std::move(actions)),
+        options(options)
+    {
+        loaded = machine.loadProgram(rom, romSize);
+
+        // So that step and reset never copy a page on its first write
+        machine.getMemory().unsharePages();
+
+        for (std::uint64_t i = 0; i < options.bootFrames; i++) {
+            runFrame();
+        }
+
+        machine.saveState(bootState);
+        bootCycleRemainder = cycleRemainder;
+    }
+
+    // A frame is 1/targetHostFps of emulated time, the remainder of
+    // targetCpuFrequency / targetHostFps is carried between frames
+    void Environment::runFrame()
+    {
+        cycleRemainder += c8::config::targetCpuFrequency;
+
+        const int cycles = cycleRemainder / c8::config::targetHostFps;
+
+        cycleRemainder %= c8::config::targetHostFps;
+
+        for (int i = 0; i < cycles; i++) {
+            machine.executeClockCycle();
+        }
+    }
+
+    bool Environment::isDone() const
+    {
+        if (machine.getInvalidOpcodeCount() > 0) {
+            return true;
+        }
+
+        if (options.maxEpisodeFrames > 0 && episodeFrames >= options.maxEpisodeFrames) {
+            return true;
+        }
+
+        const std::uint16_t pc = machine.getCpuState().pc;
+
+        return machine.getMemory().readWord(pc) == (0x1000 | pc);
+    }
+
+    const std::uint64_t* Environment::reset()
+    {
+        machine.restoreState(bootState);
+
+        cycleRemainder = bootCycleRemainder;
+        episodeFrames = 0;
+
+        return machine.getVgaState().getRows();
+    }
+
+    StepResult Environment::step(const std::size_t action, const int frameskip)
+    {
+        // A step always runs a frame, and a negative count must not wrap
+        // the unsigned episode counter
+        const int frames = std::max(1, frameskip);
+
+        machine.setKeypad(action < actions.size() ? actions[action] : 0);
+
+        for (int i = 0; i < frames; i++) {
+            runFrame();
+        }
+
+        episodeFrames += static_cast<std::uint64_t>(frames);
+
+        return {machine.getVgaState().getRows(), isDone()};
+    }
+
+    bool Environment::isLoaded() const
+    {
+        return loaded;
+    }
+
+    std::size_t Environment::getActionCount() const
+    {
+        return actions.size();
+    }
+
+    const c8::Machine& Environment::getMachine() const
+    {
+        return machine;
+    }
+}
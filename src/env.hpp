@@ -0,0 +1,111 @@
+/**
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "machine.hpp"
+
+namespace c8::env
+{
+    struct Options
+    {
+        // Frames run without input after loading, the state they end in is
+        // what every reset() returns to
+        std::uint64_t bootFrames = 0;
+
+        // An episode ends after this many frames, 0 for no limit
+        std::uint64_t maxEpisodeFrames = 0;
+
+        std::uint32_t seed = 1;
+    };
+
+    struct StepResult
+    {
+        // frameBufferHeight rows of 64 pixels, see VgaState::getRows. Points
+        // into the machine, so it is only valid until the next call.
+        const std::uint64_t* observation;
+
+        bool done;
+    };
+
+    /**
+     * Step and reset interface for training agents on a ROM. An action is an
+     * index into a table of keypad states, a step holds that state down for
+     * a number of frames and returns the frame buffer as it is, without
+     * copying. Resetting restores a state saved once after booting instead
+     * of reloading the ROM.
+     *
+     * An episode is done when the program hits an invalid opcode, halts on a
+     * jump to itself, or runs for maxEpisodeFrames.
+    */
+    class Environment
+    {
+    private:
+        c8::Machine machine;
+        c8::Machine::SavedState bootState;
+
+        std::vector<std::uint16_t> actions;
+
+        Options options;
+
+        bool loaded;
+
+        std::uint64_t episodeFrames = 0;
+        int cycleRemainder = 0;
+        int bootCycleRemainder = 0;
+
+        void runFrame();
+
+        bool isDone() const;
+
+    public:
+        /**
+         * actions holds the keypad state of each action, bit n set means key
+         * n is down. If empty, action 0 presses nothing and action n + 1
+         * presses key n.
+        */
+        Environment(
+            const std::uint8_t* rom,
+            const std::size_t romSize,
+            std::vector<std::uint16_t> actions = {},
+            const Options& options = {});
+
+        Environment(const Environment&) = delete;
+        Environment& operator=(const Environment&) = delete;
+
+        /**
+         * Returns to the state after booting and returns the observation
+        */
+        const std::uint64_t* reset();
+
+        /**
+         * Holds action for frameskip frames, at least one
+        */
+        StepResult step(const std::size_t action, const int frameskip = 1);
+
+        /**
+         * False if the ROM did not fit in memory
+        */
+        bool isLoaded() const;
+
+        std::size_t getActionCount() const;
+
+        const c8::Machine& getMachine() const;
+    };
+}
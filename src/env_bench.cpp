@@ -0,0 +1,162 @@
+/**
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "env.hpp"
+
+// Measures environment steps per second with random actions, one
+// environment per thread.
+//
+// Usage: c8-env-bench [--steps N] [--frameskip N] [--threads N] rom
+
+struct Options
+{
+    std::string romPath;
+
+    std::uint64_t steps = 1'000'000;
+    int frameskip = 4;
+    unsigned int threads = 1;
+};
+
+struct ThreadResult
+{
+    std::uint64_t resets = 0;
+    std::chrono::duration<double> wallTime{};
+};
+
+bool parseArgs(int argc, char** argv, Options& options)
+{
+    std::vector<std::string> args;
+
+    args.assign(argv + 1, argv + argc);
+
+    for (std::size_t i = 0; i < args.size(); i++) {
+        const std::string& arg = args[i];
+
+        if (arg == "--steps" && i + 1 < args.size()) {
+            options.steps = std::stoull(args[++i]);
+            continue;
+        }
+
+        if (arg == "--frameskip" && i + 1 < args.size()) {
+            options.frameskip = std::stoi(args[++i]);
+            continue;
+        }
+
+        if (arg == "--threads" && i + 1 < args.size()) {
+            options.threads = static_cast<unsigned int>(std::stoul(args[++i]));
+            continue;
+        }
+
+        options.romPath = arg;
+    }
+
+    return !options.romPath.empty() && options.threads > 0 && options.frameskip > 0;
+}
+
+void runSteps(
+    const std::vector<std::uint8_t>& rom,
+    const Options& options,
+    const std::uint32_t seed,
+    ThreadResult& result)
+{
+    using clock = std::chrono::steady_clock;
+
+    c8::env::Environment environment{rom.data(), rom.size(), {}, {0, 0, seed}};
+
+    // Cheap xorshift for picking actions, so the benchmark measures the
+    // environment rather than the action source
+    std::uint32_t random = seed | 1;
+
+    environment.reset();
+
+    const auto start = clock::now();
+
+    for (std::uint64_t i = 0; i < options.steps; i++) {
+        random ^= random << 13;
+        random ^= random >> 17;
+        random ^= random << 5;
+
+        const c8::env::StepResult step = environment.step(random % environment.getActionCount(), options.frameskip);
+
+        if (step.done) {
+            environment.reset();
+            result.resets++;
+        }
+    }
+
+    result.wallTime = clock::now() - start;
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+
+    if (!parseArgs(argc, argv, options)) {
+        std::cerr << "Usage: " << argv[0] << " [--steps N] [--frameskip N] [--threads N] rom\n";
+        return 1;
+    }
+
+    std::ifstream file{options.romPath, std::ios::binary};
+
+    if (!file.is_open()) {
+        std::cerr << "Could not open " << options.romPath << "\n";
+        return 1;
+    }
+
+    const std::vector<std::uint8_t> rom{std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+
+    if (rom.size() > c8::mem::maxBufferSize - 0x200) {
+        std::cerr << options.romPath << " does not fit in memory\n";
+        return 1;
+    }
+
+    std::vector<ThreadResult> results(options.threads);
+    std::vector<std::thread> threads;
+
+    for (unsigned int i = 0; i < options.threads; i++) {
+        threads.emplace_back(runSteps, std::cref(rom), std::cref(options), i + 1, std::ref(results[i]));
+    }
+
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    double stepsPerSecond = 0;
+    std::uint64_t resets = 0;
+
+    for (const ThreadResult& result : results) {
+        stepsPerSecond += options.steps / result.wallTime.count();
+        resets += result.resets;
+    }
+
+    std::cout << "threads              " << options.threads << "\n";
+    std::cout << "steps per thread     " << options.steps << "\n";
+    std::cout << "frameskip            " << options.frameskip << "\n";
+    std::cout << "resets               " << resets << "\n";
+    std::cout << "steps/s              " << stepsPerSecond << "\n";
+    std::cout << "steps/s per thread   " << stepsPerSecond / options.threads << "\n";
+    std::cout << "frames/s per thread  " << stepsPerSecond * options.frameskip / options.threads << "\n";
+
+    return 0;
+}
@@ -0,0 +1,122 @@
+/**
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "format.hpp"
+
+#include <algorithm>
+
+namespace c8::format
+{
+    constexpr char hexDigits[] = "0123456789ABCDEF";
+
+    Line& Line::clear()
+    {
+        length = 0;
+
+        return *this;
+    }
+
+    Line& Line::append(const char c)
+    {
+        if (length < capacity) {
+            data[length++] = c;
+        }
+
+        return *this;
+    }
+
+    Line& Line::append(std::string_view text)
+    {
+        const std::size_t count = std::min(text.size(), capacity - length);
+
+        std::copy_n(text.data(), count, data + length);
+        length += count;
+
+        return *this;
+    }
+
+    Line& Line::appendHexDigits(const std::uint64_t value, const int digits)
+    {
+        for (int shift = (digits - 1) * 4; shift >= 0; shift -= 4) {
+            append(hexDigits[(value >> shift) & 0xF]);
+        }
+
+        return *this;
+    }
+
+    Line& Line::appendHex(const std::uint8_t value, const bool includeDec)
+    {
+        append("0x").appendHexDigits(value, 2);
+
+        if (includeDec) {
+            append(" (").appendDec(value, 3).append(')');
+        }
+
+        return *this;
+    }
+
+    Line& Line::appendHex(const std::uint16_t value, const bool includeDec)
+    {
+        append("0x").appendHexDigits(value, 4);
+
+        if (includeDec) {
+            append(" (").appendDec(value, 6).append(')');
+        }
+
+        return *this;
+    }
+
+    Line& Line::appendDec(const long long value, const int width)
+    {
+        char digits[24];
+        int count = 0;
+
+        unsigned long long magnitude = value < 0 ? 0ULL - static_cast<unsigned long long>(value) : value;
+
+        do {
+            digits[count++] = static_cast<char>('0' + magnitude % 10);
+            magnitude /= 10;
+        } while (magnitude > 0);
+
+        if (value < 0) {
+            append('-');
+        }
+
+        for (int i = count; i < width; i++) {
+            append('0');
+        }
+
+        while (count > 0) {
+            append(digits[--count]);
+        }
+
+        return *this;
+    }
+
+    std::string_view Line::view() const
+    {
+        return std::string_view{data, length};
+    }
+
+    std::size_t Line::size() const
+    {
+        return length;
+    }
+
+    bool Line::operator==(const Line& other) const
+    {
+        return view() == other.view();
+    }
+}
@@ -0,0 +1,69 @@
+/**
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace c8::format
+{
+    /**
+     * A fixed capacity line of text that never allocates. Anything appended
+     * past the capacity is silently dropped.
+    */
+    class Line
+    {
+    public:
+        static constexpr std::size_t capacity = 64;
+
+    private:
+        char data[capacity];
+        std::size_t length = 0;
+
+    public:
+        Line& clear();
+
+        Line& append(const char c);
+
+        Line& append(std::string_view text);
+
+        /**
+         * "0x" and two upper-case hex digits, then the value in decimal
+         * padded to three digits unless includeDec is false, e.g. "0x2A (042)"
+        */
+        Line& appendHex(const std::uint8_t value, const bool includeDec = true);
+
+        /**
+         * "0x" and four upper-case hex digits, then the value in decimal
+         * padded to six digits unless includeDec is false, e.g. "0x022A (000554)"
+        */
+        Line& appendHex(const std::uint16_t value, const bool includeDec = true);
+
+        Line& appendDec(const long long value, const int width = 0);
+
+        /**
+         * Appends the lowest `digits` nibbles of value without a 0x prefix
+        */
+        Line& appendHexDigits(const std::uint64_t value, const int digits);
+
+        std::string_view view() const;
+
+        std::size_t size() const;
+
+        bool operator==(const Line& other) const;
+    };
+}
@@ -0,0 +1,533 @@
+/**
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "headless.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+
+#include "cpu.hpp"
+#include "machine.hpp"
+#include "config.hpp"
+#include "format.hpp"
+
+namespace c8::headless
+{
+    struct Options
+    {
+        std::string romPath;
+        std::string inputPath;
+        std::string countersPath;
+        std::string profilePath;
+        std::string collapsedPath;
+        std::string tracePath;
+        std::string heatmapPath;
+
+        bool noAllocations = false;
+
+        std::uint32_t seed = defaultSeed;
+
+        std::vector<std::uint16_t> breakpoints;
+
+        Limits limits;
+    };
+
+    bool parseArgs(int argc, char** argv, Options& options)
+    {
+        std::vector<std::string> args;
+
+        args.assign(argv + 1, argv + argc);
+
+        for (std::size_t i = 0; i < args.size(); i++) {
+            const std::string& arg = args[i];
+
+            if (arg == "--headless") {
+                continue;
+            }
+
+            if (arg == "--cycles" && i + 1 < args.size()) {
+                options.limits.cycles = std::stoull(args[++i]);
+                continue;
+            }
+
+            if (arg == "--frames" && i + 1 < args.size()) {
+                options.limits.frames = std::stoull(args[++i]);
+                continue;
+            }
+
+            if (arg == "--seed" && i + 1 < args.size()) {
+                options.seed = static_cast<std::uint32_t>(std::stoul(args[++i]));
+                continue;
+            }
+
+            if (arg == "--input" && i + 1 < args.size()) {
+                options.inputPath = args[++i];
+                continue;
+            }
+
+            if (arg == "--counters" && i + 1 < args.size()) {
+                options.countersPath = args[++i];
+                continue;
+            }
+
+            if (arg == "--profile" && i + 1 < args.size()) {
+                options.profilePath = args[++i];
+                continue;
+            }
+
+            if (arg == "--collapsed" && i + 1 < args.size()) {
+                options.collapsedPath = args[++i];
+                continue;
+            }
+
+            if (arg == "--trace" && i + 1 < args.size()) {
+                options.tracePath = args[++i];
+                continue;
+            }
+
+            if (arg == "--heatmap" && i + 1 < args.size()) {
+                options.heatmapPath = args[++i];
+                continue;
+            }
+
+            if (arg == "--break" && i + 1 < args.size()) {
+                options.breakpoints.push_back(static_cast<std::uint16_t>(std::stoul(args[++i], nullptr, 16)));
+                continue;
+            }
+
+            if (arg == "--no-allocations") {
+                options.noAllocations = true;
+                continue;
+            }
+
+            options.romPath = arg;
+        }
+
+        if (options.limits.cycles == 0 && options.limits.frames == 0) {
+            options.limits.frames = defaultFrames;
+        }
+
+        // Only one counter policy runs at a time
+        const int policies = (options.profilePath.empty() && options.collapsedPath.empty() ? 0 : 1)
+            + (options.countersPath.empty() ? 0 : 1)
+            + (options.tracePath.empty() ? 0 : 1)
+            + (options.heatmapPath.empty() ? 0 : 1);
+
+        return !options.romPath.empty() && policies <= 1;
+    }
+
+    bool loadInputScript(const std::string& path, std::vector<InputEvent>& events)
+    {
+        std::ifstream file{path};
+
+        if (!file.is_open()) {
+            return false;
+        }
+
+        std::string text;
+
+        while (std::getline(file, text)) {
+            if (text.empty() || text[0] == '#') {
+                continue;
+            }
+
+            std::istringstream line{text};
+
+            std::uint64_t frame;
+            std::string action;
+            int key;
+
+            if (!(line >> frame >> action >> std::hex >> key) || key < 0 || key > 0xF) {
+                std::cerr << "Invalid input script line: " << text << "\n";
+                return false;
+            }
+
+            const c8::cpu::CommandType type = action == "down" ? 
+                c8::cpu::CommandType::KeyDown : 
+                c8::cpu::CommandType::KeyUp;
+
+            events.push_back({frame, {type, static_cast<std::uint8_t>(key)}});
+        }
+
+        std::stable_sort(events.begin(), events.end(), [](const InputEvent& a, const InputEvent& b) {
+            return a.frame < b.frame;
+        });
+
+        return true;
+    }
+
+    void printResults(const c8::cpu::Snapshot& snapshot, const Result& result, const Options& options)
+    {
+        c8::format::Line line;
+
+        std::cout << "seed       " << options.seed << "\n";
+        std::cout << "cycles     " << result.cycles << "\n";
+        std::cout << "frames     " << result.frames << "\n";
+
+        line.clear().append("pc         ").appendHex(snapshot.pc, false);
+        std::cout << line.view() << "\n";
+
+        line.clear().append("i          ").appendHex(snapshot.ir, false);
+        std::cout << line.view() << "\n";
+
+        line.clear().append("dt         ").appendHex(snapshot.dt, false);
+        std::cout << line.view() << "\n";
+
+        line.clear().append("st         ").appendHex(snapshot.st, false);
+        std::cout << line.view() << "\n";
+
+        for (int i = 0; i < 16; i++) {
+            line.clear().append('v').appendHexDigits(i, 1).append("         ").appendHex(snapshot.v[i], false);
+            std::cout << line.view() << "\n";
+        }
+
+        line.clear().append("frame hash ").append("0x").appendHexDigits(snapshot.vgaState.hash(), 16);
+        std::cout << line.view() << "\n";
+
+        const double seconds = result.wallTime.count();
+
+        std::cout << "wall time  " << seconds << "s\n";
+        std::cout << "throughput " << (seconds > 0 ? result.cycles / seconds / 1'000'000 : 0) << " MIPS\n";
+
+        if (result.stoppedAtBreakpoint) {
+            line.clear().append("breakpoint ").appendHex(snapshot.pc, false);
+            std::cout << line.view() << "\n";
+        }
+
+        if constexpr (c8::allocations::tracking) {
+            std::cout << "allocs     " << result.steadyAllocations.allocations
+                      << " (" << result.steadyAllocations.bytes << " bytes) after the first frame\n";
+        }
+    }
+
+    template <typename Counters>
+    Result runFrames(
+        c8::Machine& machine,
+        const Limits& limits,
+        const std::vector<InputEvent>& events,
+        Counters& counters)
+    {
+        using clock = std::chrono::steady_clock;
+
+        // A frame is 1/targetHostFps of emulated time, the remainder of
+        // targetCpuFrequency / targetHostFps is carried between frames
+        int cycleRemainder = 0;
+
+        std::uint64_t cycles = 0;
+        std::uint64_t frames = 0;
+
+        auto nextEvent = events.begin();
+
+        c8::allocations::Counts firstFrameAllocations;
+
+        bool stoppedAtBreakpoint = false;
+
+        const auto start = clock::now();
+
+        while (true) {
+            if (limits.frames > 0 && frames >= limits.frames) {
+                break;
+            }
+
+            if (limits.cycles > 0 && cycles >= limits.cycles) {
+                break;
+            }
+
+            while (nextEvent != events.end() && nextEvent->frame <= frames) {
+                machine.processCommand(nextEvent->command);
+                nextEvent++;
+            }
+
+            cycleRemainder += c8::config::targetCpuFrequency;
+
+            std::uint64_t cyclesThisFrame = cycleRemainder / c8::config::targetHostFps;
+
+            cycleRemainder %= c8::config::targetHostFps;
+
+            if (limits.cycles > 0) {
+                cyclesThisFrame = std::min(cyclesThisFrame, limits.cycles - cycles);
+            }
+
+            const int cyclesRun = machine.executeClockCycles(static_cast<int>(cyclesThisFrame), counters);
+
+            cycles += cyclesRun;
+            frames++;
+
+            if (frames == 1) {
+                firstFrameAllocations = c8::allocations::getThreadCounts();
+            }
+
+            if (static_cast<std::uint64_t>(cyclesRun) < cyclesThisFrame) {
+                stoppedAtBreakpoint = true;
+                break;
+            }
+        }
+
+        const auto wallTime = clock::now() - start;
+
+        if (frames <= 1) {
+            return {cycles, frames, wallTime, {}, stoppedAtBreakpoint};
+        }
+
+        return {cycles, frames, wallTime, c8::allocations::getThreadCounts() - firstFrameAllocations, stoppedAtBreakpoint};
+    }
+
+    Result runMachine(
+        c8::Machine& machine,
+        const Limits& limits,
+        const std::vector<InputEvent>& events)
+    {
+        c8::counters::NoCounters counters;
+
+        return runFrames(machine, limits, events, counters);
+    }
+
+    Result runMachine(
+        c8::Machine& machine,
+        const Limits& limits,
+        const std::vector<InputEvent>& events,
+        c8::counters::InstructionCounters& counters)
+    {
+        return runFrames(machine, limits, events, counters);
+    }
+
+    Result runMachine(
+        c8::Machine& machine,
+        const Limits& limits,
+        const std::vector<InputEvent>& events,
+        c8::callgraph::Profiler& profiler)
+    {
+        const Result result = runFrames(machine, limits, events, profiler);
+
+        profiler.flushHostTime();
+
+        return result;
+    }
+
+    Result runMachine(
+        c8::Machine& machine,
+        const Limits& limits,
+        const std::vector<InputEvent>& events,
+        c8::trace::Recorder& recorder)
+    {
+        return runFrames(machine, limits, events, recorder);
+    }
+
+    Result runMachine(
+        c8::Machine& machine,
+        const Limits& limits,
+        const std::vector<InputEvent>& events,
+        c8::heatmap::AccessCounters& accessCounters)
+    {
+        return runFrames(machine, limits, events, accessCounters);
+    }
+
+    bool writeFile(const std::string& path, const auto& write)
+    {
+        std::ofstream out{path};
+
+        if (!out.is_open()) {
+            std::cerr << "Could not open " << path << "\n";
+            return false;
+        }
+
+        write(out);
+
+        return true;
+    }
+
+    void printTopCounters(const c8::counters::InstructionCounters& counters)
+    {
+        c8::counters::TopList opcodes;
+        c8::counters::TopList addresses;
+
+        counters.fillTop(opcodes, addresses);
+
+        const std::uint64_t total = std::max<std::uint64_t>(counters.getTotal(), 1);
+
+        for (const c8::counters::TopEntry& entry : opcodes) {
+            if (entry.count > 0) {
+                std::cout << "top opcode " << c8::opcodes::getOpcodeIdentifier(static_cast<c8::opcodes::Opcode>(entry.key))
+                          << " " << 100 * entry.count / total << "%\n";
+            }
+        }
+
+        c8::format::Line line;
+
+        for (const c8::counters::TopEntry& entry : addresses) {
+            if (entry.count > 0) {
+                line.clear().append("top addr   ").appendHex(static_cast<std::uint16_t>(entry.key), false)
+                    .append(' ').appendDec(static_cast<long long>(100 * entry.count / total)).append('%');
+                std::cout << line.view() << "\n";
+            }
+        }
+    }
+
+    bool checkAllocations(const Options& options, const Result& result)
+    {
+        if (!options.noAllocations || result.steadyAllocations.allocations == 0) {
+            return true;
+        }
+
+        std::cerr << "Allocated " << result.steadyAllocations.allocations << " times after the first frame\n";
+
+        return false;
+    }
+
+    int run(int argc, char** argv)
+    {
+        Options options;
+
+        if (!parseArgs(argc, argv, options)) {
+            std::cerr << "Usage: " << argv[0] << " [--headless] [--cycles N | --frames N] [--input script] [--seed N] [--counters file | --profile file [--collapsed file] | --trace file | --heatmap file] [--break addr]... [--no-allocations] rom\n";
+            return 1;
+        }
+
+        if (options.noAllocations && !c8::allocations::tracking) {
+            std::cerr << "--no-allocations needs a build with C8_TRACK_ALLOCATIONS\n";
+            return 1;
+        }
+
+        std::ifstream rom{options.romPath, std::ios::binary};
+
+        if (!rom.is_open()) {
+            std::cerr << "Could not open " << options.romPath << "\n";
+            return 1;
+        }
+
+        std::vector<InputEvent> events;
+
+        if (!options.inputPath.empty() && !loadInputScript(options.inputPath, events)) {
+            std::cerr << "Could not load input script " << options.inputPath << "\n";
+            return 1;
+        }
+
+        // No history is kept, nothing is ever rewound here
+        c8::Machine machine{0, options.seed};
+
+        machine.loadProgram(rom);
+        machine.getMemory().unsharePages();
+
+        for (const std::uint16_t addr : options.breakpoints) {
+            machine.getBreakpoints().set(addr, true);
+        }
+
+        if (!options.tracePath.empty()) {
+            // Holds a queue of trace records, too much for the stack
+            const auto recorder = std::make_unique<c8::trace::Recorder>();
+
+            Result result;
+
+            {
+                c8::trace::Writer writer{*recorder, options.tracePath};
+
+                if (!writer.isOpen()) {
+                    std::cerr << "Could not open " << options.tracePath << "\n";
+                    return 1;
+                }
+
+                result = runMachine(machine, options.limits, events, *recorder);
+            }
+
+            c8::cpu::Snapshot snapshot;
+
+            machine.takeSnapshot(snapshot);
+
+            printResults(snapshot, result, options);
+
+            std::cout << "dropped    " << recorder->getDroppedCount() << " trace records\n";
+
+            return checkAllocations(options, result) ? 0 : 1;
+        }
+
+        if (!options.profilePath.empty() || !options.collapsedPath.empty()) {
+            c8::callgraph::Profiler profiler;
+
+            const Result result = runMachine(machine, options.limits, events, profiler);
+
+            c8::cpu::Snapshot snapshot;
+
+            machine.takeSnapshot(snapshot);
+
+            printResults(snapshot, result, options);
+
+            if (!options.profilePath.empty() && !writeFile(options.profilePath, [&](std::ostream& out) { profiler.writeReport(out); })) {
+                return 1;
+            }
+
+            if (!options.collapsedPath.empty() && !writeFile(options.collapsedPath, [&](std::ostream& out) { profiler.writeCollapsed(out); })) {
+                return 1;
+            }
+
+            return checkAllocations(options, result) ? 0 : 1;
+        }
+
+        if (!options.heatmapPath.empty()) {
+            // 96 KB of counters, too much for the stack
+            const auto accessCounters = std::make_unique<c8::heatmap::AccessCounters>();
+
+            const Result result = runMachine(machine, options.limits, events, *accessCounters);
+
+            c8::cpu::Snapshot snapshot;
+
+            machine.takeSnapshot(snapshot);
+
+            printResults(snapshot, result, options);
+
+            if (!writeFile(options.heatmapPath, [&](std::ostream& out) { accessCounters->writeCsv(out); })) {
+                return 1;
+            }
+
+            return checkAllocations(options, result) ? 0 : 1;
+        }
+
+        if (options.countersPath.empty()) {
+            const Result result = runMachine(machine, options.limits, events);
+
+            c8::cpu::Snapshot snapshot;
+
+            machine.takeSnapshot(snapshot);
+
+            printResults(snapshot, result, options);
+
+            return checkAllocations(options, result) ? 0 : 1;
+        }
+
+        // 36 KB of counters, too much for the stack
+        const auto counters = std::make_unique<c8::counters::InstructionCounters>();
+
+        const Result result = runMachine(machine, options.limits, events, *counters);
+
+        c8::cpu::Snapshot snapshot;
+
+        machine.takeSnapshot(snapshot);
+
+        printResults(snapshot, result, options);
+        printTopCounters(*counters);
+
+        if (!writeFile(options.countersPath, [&](std::ostream& out) { counters->writeCsv(out); })) {
+            return 1;
+        }
+
+        return checkAllocations(options, result) ? 0 : 1;
+    }
+}
@@ -0,0 +1,143 @@
+/**
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "allocations.hpp"
+#include "callgraph.hpp"
+#include "counters.hpp"
+#include "cpu.hpp"
+#include "heatmap.hpp"
+#include "trace.hpp"
+#include "machine.hpp"
+
+namespace c8::headless
+{
+    inline constexpr std::uint64_t defaultFrames = 600;
+
+    // The same seed on every run, so RND gives the same results each time
+    inline constexpr std::uint32_t defaultSeed = 1;
+
+    struct InputEvent
+    {
+        std::uint64_t frame;
+        c8::cpu::Command command;
+    };
+
+    /**
+     * What a run stops at, whichever limit is reached first. A limit of 0
+     * is ignored.
+    */
+    struct Limits
+    {
+        std::uint64_t cycles = 0;
+        std::uint64_t frames = 0;
+    };
+
+    struct Result
+    {
+        std::uint64_t cycles;
+        std::uint64_t frames;
+        std::chrono::duration<double> wallTime;
+
+        // Made by the running thread after the first frame, once every
+        // buffer has been touched. Always 0 unless allocations are tracked.
+        c8::allocations::Counts steadyAllocations;
+
+        // The run stopped early because the PC reached a breakpoint
+        bool stoppedAtBreakpoint;
+    };
+
+    /**
+     * Each line of the input script is "<frame> <down|up> <key>", with the
+     * key in hex. Lines starting with # are ignored. The events are returned
+     * sorted by frame.
+    */
+    bool loadInputScript(const std::string& path, std::vector<InputEvent>& events);
+
+    /**
+     * Runs machine frame by frame as fast as possible, applying each input
+     * event at the start of its frame. Stops early when the PC reaches one
+     * of the machine's breakpoints.
+    */
+    Result runMachine(
+        c8::Machine& machine,
+        const Limits& limits,
+        const std::vector<InputEvent>& events);
+
+    /**
+     * Same as above, also counting every executed instruction
+    */
+    Result runMachine(
+        c8::Machine& machine,
+        const Limits& limits,
+        const std::vector<InputEvent>& events,
+        c8::counters::InstructionCounters& counters);
+
+    /**
+     * Same as above, also profiling subroutines
+    */
+    Result runMachine(
+        c8::Machine& machine,
+        const Limits& limits,
+        const std::vector<InputEvent>& events,
+        c8::callgraph::Profiler& profiler);
+
+    /**
+     * Same as above, also producing a trace record per instruction
+    */
+    Result runMachine(
+        c8::Machine& machine,
+        const Limits& limits,
+        const std::vector<InputEvent>& events,
+        c8::trace::Recorder& recorder);
+
+    /**
+     * Same as above, also counting the accesses to every address
+    */
+    Result runMachine(
+        c8::Machine& machine,
+        const Limits& limits,
+        const std::vector<InputEvent>& events,
+        c8::heatmap::AccessCounters& accessCounters);
+
+    /**
+     * Runs a ROM without a window and prints the final CPU state, a hash of
+     * the frame buffer and the emulation throughput. Returns the process
+     * exit code.
+     *
+     * Usage: [--headless] [--cycles N | --frames N] [--input script]
+     *        [--seed N] [--counters file | --profile file [--collapsed file] | --trace file |
+     *         --heatmap file] [--break addr]... [--no-allocations] rom
+     *
+     * --seed sets the random number generator seed, defaultSeed if not
+     * given. --counters also prints the most executed instructions and addresses,
+     * and writes all counts to file as CSV. --profile writes the cycles
+     * and host time spent in each subroutine, --collapsed the same per call
+     * path in the collapsed stack format of flame graph tools. --trace
+     * writes every executed instruction, see c8-trace. --heatmap writes
+     * the reads, writes and instruction fetches of every address as CSV.
+     * --break, given once per address in hex, stops the run before the
+     * instruction there executes. --no-allocations
+     * fails the run if anything was allocated after the first frame, which
+     * needs a build with C8_TRACK_ALLOCATIONS.
+    */
+    int run(int argc, char** argv);
+}
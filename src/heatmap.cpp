@@ -0,0 +1,96 @@
+/**
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "heatmap.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <iomanip>
+
+namespace c8::heatmap
+{
+    void AccessCounters::clear()
+    {
+        reads.fill(0);
+        writes.fill(0);
+        fetches.fill(0);
+    }
+
+    std::uint64_t AccessCounters::getReads(const std::uint16_t addr) const
+    {
+        return addr < c8::mem::maxBufferSize ? reads[addr] : 0;
+    }
+
+    std::uint64_t AccessCounters::getWrites(const std::uint16_t addr) const
+    {
+        return addr < c8::mem::maxBufferSize ? writes[addr] : 0;
+    }
+
+    std::uint64_t AccessCounters::getFetches(const std::uint16_t addr) const
+    {
+        return addr < c8::mem::maxBufferSize ? fetches[addr] : 0;
+    }
+
+    // Any access at all shows as at least minimumIntensity, the rest of the
+    // range goes by the number of bits in the count
+    constexpr int minimumIntensity = 64;
+
+    std::uint8_t scale(const std::uint64_t count, const int maxBits)
+    {
+        if (count == 0) {
+            return 0;
+        }
+
+        const int bits = static_cast<int>(std::bit_width(count));
+
+        return static_cast<std::uint8_t>(minimumIntensity + (255 - minimumIntensity) * bits / maxBits);
+    }
+
+    void AccessCounters::fillHeatmap(c8::mem::Heatmap& heatmap) const
+    {
+        // Scaled against the most accessed address of any kind, so the
+        // three channels stay comparable
+        const std::uint64_t maxCount = std::max({
+            *std::max_element(reads.begin(), reads.end()),
+            *std::max_element(writes.begin(), writes.end()),
+            *std::max_element(fetches.begin(), fetches.end())
+        });
+
+        const int maxBits = std::max(static_cast<int>(std::bit_width(maxCount)), 1);
+
+        for (int addr = 0; addr < c8::mem::maxBufferSize; addr++) {
+            heatmap[addr] = {
+                scale(reads[addr], maxBits),
+                scale(writes[addr], maxBits),
+                scale(fetches[addr], maxBits)
+            };
+        }
+    }
+
+    void AccessCounters::writeCsv(std::ostream& out) const
+    {
+        out << "address,reads,writes,fetches\n";
+
+        for (int addr = 0; addr < c8::mem::maxBufferSize; addr++) {
+            if (reads[addr] == 0 && writes[addr] == 0 && fetches[addr] == 0) {
+                continue;
+            }
+
+            out << "0x" << std::hex << std::uppercase << std::setw(4) << std::setfill('0') << addr
+                << std::dec << std::nouppercase << std::setfill(' ')
+                << ',' << reads[addr] << ',' << writes[addr] << ',' << fetches[addr] << "\n";
+        }
+    }
+}
@@ -0,0 +1,108 @@
+/**
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <ostream>
+
+#include "cpu.hpp"
+#include "memory.hpp"
+
+namespace c8::heatmap
+{
+    /**
+     * Counter policy for Machine::executeClockCycle that counts the reads,
+     * writes and instruction fetches of every address. Data accesses are
+     * worked out from each instruction and I before it executes, so the
+     * memory functions themselves stay uncounted.
+    */
+    class AccessCounters
+    {
+    private:
+        using Counts = std::array<std::uint64_t, c8::mem::maxBufferSize>;
+
+        Counts reads{};
+        Counts writes{};
+        Counts fetches{};
+
+        static void countRange(Counts& counts, const std::uint16_t addr, const int size)
+        {
+            for (int i = 0; i < size; i++) {
+                const int address = addr + i;
+
+                if (address < c8::mem::maxBufferSize) {
+                    counts[address]++;
+                }
+            }
+        }
+
+    public:
+        static constexpr bool enabled = true;
+
+        void count(const std::uint16_t pc, const std::uint16_t word)
+        {
+            static_cast<void>(word);
+
+            countRange(fetches, pc, 2);
+        }
+
+        void beforeExecute(const c8::cpu::CpuState& state, const std::uint16_t word)
+        {
+            const int x = (word & 0x0F00) >> 8;
+
+            if ((word & 0xF000) == 0xD000) {
+                countRange(reads, state.ir, word & 0x000F);
+                return;
+            }
+
+            if ((word & 0xF000) != 0xF000) {
+                return;
+            }
+
+            switch (word & 0x00FF) {
+            case 0x33:
+                countRange(writes, state.ir, 3);
+                break;
+            case 0x55:
+                countRange(writes, state.ir, x + 1);
+                break;
+            case 0x65:
+                countRange(reads, state.ir, x + 1);
+                break;
+            }
+        }
+
+        void clear();
+
+        std::uint64_t getReads(const std::uint16_t addr) const;
+
+        std::uint64_t getWrites(const std::uint16_t addr) const;
+
+        std::uint64_t getFetches(const std::uint16_t addr) const;
+
+        /**
+         * Scales the counts into heatmap, see c8::mem::HeatmapCell
+        */
+        void fillHeatmap(c8::mem::Heatmap& heatmap) const;
+
+        /**
+         * Writes "address,reads,writes,fetches" lines for every address
+         * that was accessed at least once, in address order
+        */
+        void writeCsv(std::ostream& out) const;
+    };
+}
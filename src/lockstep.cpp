@@ -0,0 +1,685 @@
+/**
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "lockstep.hpp"
+
+#include <algorithm>
+#include <sstream>
+
+#include "opcodes.hpp"
+#include "config.hpp"
+#include "quirks.hpp"
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define C8_LOCKSTEP_AVX2 1
+#include <immintrin.h>
+#define C8_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define C8_LOCKSTEP_AVX2 0
+#endif
+
+namespace c8::lockstep
+{
+    // Groups smaller than one block a cycle may form before the remaining
+    // lanes are run one at a time
+    constexpr int maxSmallGroupsPerCycle = 4;
+
+    struct Lanes
+    {
+        std::uint16_t* pc;
+        std::uint16_t* ir;
+        std::uint8_t* dt;
+        std::uint8_t* st;
+        std::uint8_t* v[16];
+    };
+
+    /**
+     * Instructions that only read and write registers, which the vector path
+     * can run for a whole group of lanes at once
+    */
+    bool isVectorizable(const c8::opcodes::Opcode opcode, const std::uint8_t x)
+    {
+        using c8::opcodes::Opcode;
+
+        switch (opcode) {
+        case Opcode::JP_Addr:
+        case Opcode::SE_Vx_Byte:
+        case Opcode::SNE_Vx_Byte:
+        case Opcode::SE_Vx_Vy:
+        case Opcode::LD_Vx_Byte:
+        case Opcode::ADD_Vx_Byte:
+        case Opcode::LD_Vx_Vy:
+        case Opcode::OR_Vx_Vy:
+        case Opcode::AND_Vx_Vy:
+        case Opcode::XOR_Vx_Vy:
+        case Opcode::ADD_Vx_Vy:
+        case Opcode::SUB_Vx_Vy:
+        case Opcode::SUBN_Vx_Vy:
+        case Opcode::SNE_Vx_Vy:
+        case Opcode::LD_I_Addr:
+        case Opcode::JP_V0_Addr:
+        case Opcode::LD_Vx_DT:
+        case Opcode::LD_DT_Vx:
+        case Opcode::LD_ST_Vx:
+        case Opcode::ADD_I_Vx:
+        case Opcode::LD_F_Vx:
+            return true;
+        case Opcode::SHR_Vx_Vy:
+        case Opcode::SHL_Vx_Vy:
+            // The handlers shift VF after storing the flag in it, leave
+            // that case to them
+            return x != 0xF;
+        default:
+            return false;
+        }
+    }
+
+#if C8_LOCKSTEP_AVX2
+    C8_TARGET_AVX2
+    __m256i loadBlock(const void* p)
+    {
+        return _mm256_loadu_si256(static_cast<const __m256i*>(p));
+    }
+
+    C8_TARGET_AVX2
+    void storeBlock(void* p, const __m256i value)
+    {
+        _mm256_storeu_si256(static_cast<__m256i*>(p), value);
+    }
+
+    /**
+     * Writes value to the 32 byte lanes at p that are set in m
+    */
+    C8_TARGET_AVX2
+    void storeMasked(std::uint8_t* p, const __m256i m, const __m256i value)
+    {
+        storeBlock(p, _mm256_blendv_epi8(loadBlock(p), value, m));
+    }
+
+    /**
+     * 16 bit lanes take two registers per block, lo holds lanes 0-15
+    */
+    C8_TARGET_AVX2
+    void storeMasked16(std::uint16_t* p, const __m256i m, const __m256i lo, const __m256i hi)
+    {
+        const __m256i mLo = _mm256_cvtepi8_epi16(_mm256_castsi256_si128(m));
+        const __m256i mHi = _mm256_cvtepi8_epi16(_mm256_extracti128_si256(m, 1));
+
+        storeBlock(p, _mm256_blendv_epi8(loadBlock(p), lo, mLo));
+        storeBlock(p + 16, _mm256_blendv_epi8(loadBlock(p + 16), hi, mHi));
+    }
+
+    C8_TARGET_AVX2
+    __m256i widenLo(const __m256i bytes)
+    {
+        return _mm256_cvtepu8_epi16(_mm256_castsi256_si128(bytes));
+    }
+
+    C8_TARGET_AVX2
+    __m256i widenHi(const __m256i bytes)
+    {
+        return _mm256_cvtepu8_epi16(_mm256_extracti128_si256(bytes, 1));
+    }
+
+    /**
+     * pc += 2 in the lanes set in m, or 4 where skip is also set
+    */
+    C8_TARGET_AVX2
+    void advancePc(std::uint16_t* pc, const __m256i m, const __m256i skip)
+    {
+        const __m256i two = _mm256_set1_epi8(2);
+        const __m256i increment = _mm256_and_si256(m, _mm256_add_epi8(two, _mm256_and_si256(skip, two)));
+
+        storeBlock(pc, _mm256_add_epi16(loadBlock(pc), widenLo(increment)));
+        storeBlock(pc + 16, _mm256_add_epi16(loadBlock(pc + 16), widenHi(increment)));
+    }
+
+    /**
+     * Same results as CpuState's handlers, for the lanes set in mask
+     * between begin and end, both multiples of lanesPerBlock
+    */
+    C8_TARGET_AVX2
+    void executeAvx2(
+        const Lanes& lanes, 
+        const std::uint8_t* mask, 
+        const std::size_t begin, 
+        const std::size_t end, 
+        const std::uint16_t word)
+    {
+        using c8::opcodes::Opcode;
+
+        const Opcode opcode = c8::opcodes::decode(word);
+
+        const std::uint8_t x = c8::opcodes::getOpcodeX(word);
+        const std::uint8_t y = c8::opcodes::getOpcodeY(word);
+
+        const std::uint8_t kk = c8::opcodes::getOpcodeKK(word);
+        const std::uint16_t nnn = c8::opcodes::getOpcodeNNN(word);
+
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i one = _mm256_set1_epi8(1);
+        const __m256i ones = _mm256_set1_epi8(-1);
+        const __m256i byte = _mm256_set1_epi8(static_cast<char>(kk));
+        const __m256i addr = _mm256_set1_epi16(static_cast<short>(nnn));
+
+        for (std::size_t o = begin; o < end; o += lanesPerBlock) {
+            const __m256i m = loadBlock(mask + o);
+
+            if (_mm256_testz_si256(m, m)) {
+                continue;
+            }
+
+            std::uint16_t* pc = lanes.pc + o;
+            std::uint16_t* ir = lanes.ir + o;
+            std::uint8_t* vx = lanes.v[x] + o;
+            std::uint8_t* vf = lanes.v[0xF] + o;
+
+            const __m256i a = loadBlock(vx);
+            const __m256i b = loadBlock(lanes.v[y] + o);
+
+            switch (opcode) {
+            case Opcode::JP_Addr:
+                storeMasked16(pc, m, addr, addr);
+                break;
+            case Opcode::SE_Vx_Byte:
+                advancePc(pc, m, _mm256_cmpeq_epi8(a, byte));
+                break;
+            case Opcode::SNE_Vx_Byte:
+                advancePc(pc, m, _mm256_xor_si256(_mm256_cmpeq_epi8(a, byte), ones));
+                break;
+            case Opcode::SE_Vx_Vy:
+                advancePc(pc, m, _mm256_cmpeq_epi8(a, b));
+                break;
+            case Opcode::SNE_Vx_Vy:
+                advancePc(pc, m, _mm256_xor_si256(_mm256_cmpeq_epi8(a, b), ones));
+                break;
+            case Opcode::LD_Vx_Byte:
+                storeMasked(vx, m, byte);
+                advancePc(pc, m, zero);
+                break;
+            case Opcode::ADD_Vx_Byte:
+                storeMasked(vx, m, _mm256_add_epi8(a, byte));
+                advancePc(pc, m, zero);
+                break;
+            case Opcode::LD_Vx_Vy:
+                storeMasked(vx, m, b);
+                advancePc(pc, m, zero);
+                break;
+            case Opcode::OR_Vx_Vy:
+                storeMasked(vx, m, _mm256_or_si256(a, b));
+                advancePc(pc, m, zero);
+                break;
+            case Opcode::AND_Vx_Vy:
+                storeMasked(vx, m, _mm256_and_si256(a, b));
+                advancePc(pc, m, zero);
+                break;
+            case Opcode::XOR_Vx_Vy:
+                storeMasked(vx, m, _mm256_xor_si256(a, b));
+                advancePc(pc, m, zero);
+                break;
+            case Opcode::ADD_Vx_Vy: {
+                // a + b carries when a > 255 - b
+                const __m256i noCarry = _mm256_cmpeq_epi8(_mm256_min_epu8(a, _mm256_xor_si256(b, ones)), a);
+
+                storeMasked(vf, m, _mm256_andnot_si256(noCarry, one));
+                storeMasked(vx, m, _mm256_add_epi8(a, b));
+                advancePc(pc, m, zero);
+                break;
+            }
+            case Opcode::SUB_Vx_Vy: {
+                const __m256i notGreater = _mm256_cmpeq_epi8(_mm256_min_epu8(a, b), a);
+
+                storeMasked(vf, m, _mm256_andnot_si256(notGreater, one));
+                storeMasked(vx, m, _mm256_sub_epi8(a, b));
+                advancePc(pc, m, zero);
+                break;
+            }
+            case Opcode::SUBN_Vx_Vy: {
+                const __m256i notGreater = _mm256_cmpeq_epi8(_mm256_min_epu8(a, b), b);
+
+                storeMasked(vf, m, _mm256_andnot_si256(notGreater, one));
+                storeMasked(vx, m, _mm256_sub_epi8(b, a));
+                advancePc(pc, m, zero);
+                break;
+            }
+            case Opcode::SHR_Vx_Vy: {
+                const __m256i source = c8::quirks::shiftWithVy ? b : a;
+
+                storeMasked(vf, m, _mm256_and_si256(source, one));
+                storeMasked(vx, m, _mm256_and_si256(_mm256_srli_epi16(source, 1), _mm256_set1_epi8(0x7F)));
+                advancePc(pc, m, zero);
+                break;
+            }
+            case Opcode::SHL_Vx_Vy: {
+                const __m256i source = c8::quirks::shiftWithVy ? b : a;
+
+                storeMasked(vf, m, _mm256_and_si256(_mm256_srli_epi16(source, 7), one));
+                storeMasked(vx, m, _mm256_add_epi8(source, source));
+                advancePc(pc, m, zero);
+                break;
+            }
+            case Opcode::LD_I_Addr:
+                storeMasked16(ir, m, addr, addr);
+                advancePc(pc, m, zero);
+                break;
+            case Opcode::JP_V0_Addr: {
+                const __m256i v0 = loadBlock(lanes.v[0] + o);
+
+                storeMasked16(pc, m, _mm256_add_epi16(addr, widenLo(v0)), _mm256_add_epi16(addr, widenHi(v0)));
+                break;
+            }
+            case Opcode::LD_Vx_DT:
+                storeMasked(vx, m, loadBlock(lanes.dt + o));
+                advancePc(pc, m, zero);
+                break;
+            case Opcode::LD_DT_Vx:
+                storeMasked(lanes.dt + o, m, a);
+                advancePc(pc, m, zero);
+                break;
+            case Opcode::LD_ST_Vx:
+                storeMasked(lanes.st + o, m, a);
+                advancePc(pc, m, zero);
+                break;
+            case Opcode::ADD_I_Vx:
+                storeMasked16(ir, m, 
+                    _mm256_add_epi16(loadBlock(ir), widenLo(a)), 
+                    _mm256_add_epi16(loadBlock(ir + 16), widenHi(a)));
+                advancePc(pc, m, zero);
+                break;
+            case Opcode::LD_F_Vx: {
+                const __m256i spriteSize = _mm256_set1_epi16(5);
+
+                storeMasked16(ir, m, 
+                    _mm256_mullo_epi16(widenLo(a), spriteSize), 
+                    _mm256_mullo_epi16(widenHi(a), spriteSize));
+                advancePc(pc, m, zero);
+                break;
+            }
+            default:
+                break;
+            }
+        }
+    }
+#endif
+
+    bool cpuSupportsAvx2()
+    {
+#if C8_LOCKSTEP_AVX2
+        return __builtin_cpu_supports("avx2");
+#else
+        return false;
+#endif
+    }
+
+    Batch::Batch(const std::size_t laneCount, std::istream& rom, const std::uint32_t firstSeed) :
+        laneCount(laneCount),
+        paddedLaneCount((laneCount + lanesPerBlock - 1) / lanesPerBlock * lanesPerBlock),
+        useAvx2(cpuSupportsAvx2()),
+        lockstep(useAvx2)
+    {
+        const std::string romData{std::istreambuf_iterator<char>{rom}, std::istreambuf_iterator<char>{}};
+
+        for (std::size_t lane = 0; lane < laneCount; lane++) {
+            std::istringstream programStream{romData};
+
+            c8::Machine& machine = machines.emplace_back(0, firstSeed + static_cast<std::uint32_t>(lane));
+
+            machine.loadProgram(programStream);
+        }
+
+        if (laneCount > 0) {
+            machines.front().getMemory().copyTo(program.data());
+        }
+
+        dirty.assign(paddedLaneCount, 0);
+
+        pc.assign(paddedLaneCount, 0x200);
+        ir.assign(paddedLaneCount, 0);
+        dt.assign(paddedLaneCount, 0);
+        st.assign(paddedLaneCount, 0);
+        sp.assign(paddedLaneCount, 0);
+
+        for (std::vector<std::uint8_t>& registers : v) {
+            registers.assign(paddedLaneCount, 0);
+        }
+
+        stack.assign(paddedLaneCount, {});
+        idleCycles.assign(paddedLaneCount, 0);
+
+        words.assign(paddedLaneCount, 0);
+        pending.assign(paddedLaneCount, 0);
+        mask.assign(paddedLaneCount, 0);
+    }
+
+    void Batch::loadLane(const std::size_t lane, c8::cpu::CpuState& cpuState) const
+    {
+        cpuState.pc = pc[lane];
+        cpuState.ir = ir[lane];
+        cpuState.dt = dt[lane];
+        cpuState.st = st[lane];
+        cpuState.sp = sp[lane];
+        cpuState.stack = stack[lane];
+
+        for (int i = 0; i < 16; i++) {
+            cpuState.v[i] = v[i][lane];
+        }
+    }
+
+    void Batch::storeLane(const std::size_t lane, const c8::cpu::CpuState& cpuState)
+    {
+        pc[lane] = cpuState.pc;
+        ir[lane] = cpuState.ir;
+        dt[lane] = cpuState.dt;
+        st[lane] = cpuState.st;
+        sp[lane] = cpuState.sp;
+        stack[lane] = cpuState.stack;
+
+        for (int i = 0; i < 16; i++) {
+            v[i][lane] = cpuState.v[i];
+        }
+    }
+
+    void Batch::executeScalar(const std::size_t lane, const std::uint16_t word)
+    {
+        c8::Machine& machine = machines[lane];
+        c8::cpu::CpuState& cpuState = machine.getCpuState();
+
+        loadLane(lane, cpuState);
+        cpuState.execute(machine, word);
+        storeLane(lane, cpuState);
+
+        const c8::opcodes::Opcode opcode = c8::opcodes::decode(word);
+
+        const bool writesMemory = 
+            opcode == c8::opcodes::Opcode::LD_B_Vx || 
+            opcode == c8::opcodes::Opcode::LD_IAddr_Vx;
+
+        if (writesMemory && dirty[lane] == 0) {
+            dirty[lane] = 0xFF;
+            dirtyLaneCount++;
+        }
+    }
+
+    // Every lane runs the same number of cycles, so one remainder serves
+    // them all, see Machine::advanceTimers
+    void Batch::advanceTimers()
+    {
+        timerCycles += c8::config::timerFrequency;
+
+        if (timerCycles < c8::config::targetCpuFrequency) {
+            return;
+        }
+
+        timerCycles -= c8::config::targetCpuFrequency;
+
+        for (std::size_t lane = 0; lane < paddedLaneCount; lane++) {
+            dt[lane] -= dt[lane] > 0 ? 1 : 0;
+            st[lane] -= st[lane] > 0 ? 1 : 0;
+        }
+    }
+
+    std::uint16_t readWord(const std::uint8_t* data, const std::uint16_t addr)
+    {
+        const std::uint8_t highByte = addr < c8::mem::maxBufferSize ? data[addr] : 0;
+        const std::uint8_t lowByte = addr + 1 < c8::mem::maxBufferSize ? data[addr + 1] : 0;
+
+        return (highByte << 8) | lowByte;
+    }
+
+    std::uint16_t Batch::fetchWord(const std::size_t lane) const
+    {
+        if (dirty[lane] != 0) {
+            return machines[lane].getMemory().readWord(pc[lane]);
+        }
+
+        return readWord(program.data(), pc[lane]);
+    }
+
+    void Batch::executePendingScalar(const std::size_t first)
+    {
+        for (std::size_t lane = first; lane < laneCount; lane++) {
+            if (pending[lane] == 0) {
+                continue;
+            }
+
+            const std::uint16_t word = fetchWord(lane);
+
+            if (word != 0x0) {
+                executeScalar(lane, word);
+                stats.scalarLaneSteps++;
+            } else {
+                idleCycles[lane]++;
+            }
+        }
+    }
+
+    void Batch::executeClockCycle()
+    {
+        // Only lanes that wrote to memory can see a different word at the
+        // same pc
+        const bool wordsFetched = dirtyLaneCount > 0;
+
+        if (wordsFetched) {
+            for (std::size_t lane = 0; lane < laneCount; lane++) {
+                words[lane] = fetchWord(lane);
+            }
+        }
+
+        std::fill_n(pending.begin(), laneCount, 0xFF);
+
+        cycles++;
+
+        bool scattered = false;
+
+        std::size_t remaining = laneCount;
+        std::size_t first = 0;
+        int smallGroups = 0;
+
+        while (remaining > 0) {
+            // Once the lanes have scattered, finding each group costs more
+            // than running what is left one lane at a time
+            if (smallGroups == maxSmallGroupsPerCycle) {
+                executePendingScalar(first);
+                scattered = true;
+                break;
+            }
+
+            while (pending[first] == 0) {
+                first++;
+            }
+
+            const std::uint16_t groupPc = pc[first];
+            const std::uint16_t groupWord = wordsFetched ? words[first] : readWord(program.data(), groupPc);
+
+            // Lanes before first are done, so earlier blocks are left alone
+            const std::size_t begin = first / lanesPerBlock * lanesPerBlock;
+
+            std::size_t groupSize = 0;
+
+            if (!wordsFetched) {
+                for (std::size_t lane = begin; lane < laneCount; lane++) {
+                    const std::uint8_t inGroup = pending[lane] & (pc[lane] == groupPc ? 0xFF : 0);
+
+                    mask[lane] = inGroup;
+                    pending[lane] ^= inGroup;
+                    groupSize += inGroup & 1;
+                }
+            } else {
+                for (std::size_t lane = begin; lane < laneCount; lane++) {
+                    const bool sameWord = pc[lane] == groupPc && words[lane] == groupWord;
+                    const std::uint8_t inGroup = pending[lane] & (sameWord ? 0xFF : 0);
+
+                    mask[lane] = inGroup;
+                    pending[lane] ^= inGroup;
+                    groupSize += inGroup & 1;
+                }
+            }
+
+            remaining -= groupSize;
+            stats.groups++;
+
+            if (groupSize < lanesPerBlock) {
+                smallGroups++;
+            }
+
+            // Like Machine::executeClockCycle, a zero word does nothing
+            if (groupWord == 0x0) {
+                for (std::size_t lane = first; lane < laneCount; lane++) {
+                    idleCycles[lane] += mask[lane] & 1;
+                }
+
+                continue;
+            }
+
+            const c8::opcodes::Opcode opcode = c8::opcodes::decode(groupWord);
+
+#if C8_LOCKSTEP_AVX2
+            if (useAvx2 && isVectorizable(opcode, c8::opcodes::getOpcodeX(groupWord))) {
+                Lanes lanes{pc.data(), ir.data(), dt.data(), st.data(), {}};
+
+                for (int i = 0; i < 16; i++) {
+                    lanes.v[i] = v[i].data();
+                }
+
+                executeAvx2(lanes, mask.data(), begin, paddedLaneCount, groupWord);
+
+                stats.vectorLaneSteps += groupSize;
+                continue;
+            }
+#else
+            (void)opcode;
+#endif
+
+            for (std::size_t lane = first; lane < laneCount; lane++) {
+                if (mask[lane] != 0) {
+                    executeScalar(lane, groupWord);
+                }
+            }
+
+            stats.scalarLaneSteps += groupSize;
+        }
+
+        scatteredCycles = scattered ? scatteredCycles + 1 : 0;
+
+        advanceTimers();
+    }
+
+    void Batch::syncLane(const std::size_t lane)
+    {
+        c8::Machine& machine = machines[lane];
+        c8::Machine::SavedState state;
+
+        machine.saveState(state);
+
+        loadLane(lane, state.cpuState);
+        state.timerCycles = timerCycles;
+        state.totalCpuCycles = cycles - idleCycles[lane];
+
+        machine.restoreState(state);
+    }
+
+    void Batch::splitIntoMachines()
+    {
+        if (!lockstep) {
+            return;
+        }
+
+        for (std::size_t lane = 0; lane < laneCount; lane++) {
+            syncLane(lane);
+        }
+
+        lockstep = false;
+    }
+
+    void Batch::stepMachines(const std::uint64_t count)
+    {
+        for (c8::Machine& machine : machines) {
+            const std::uint64_t before = machine.getTotalCpuCycles();
+
+            // A paused machine only runs a pending single step, and stays
+            // paused for the rest of the cycles
+            if (machine.isPaused()) {
+                machine.executeClockCycles(1);
+            }
+
+            for (std::uint64_t remaining = count; remaining > 0 && !machine.isPaused();) {
+                const int chunk = static_cast<int>(std::min<std::uint64_t>(remaining, 1 << 30));
+
+                machine.executeClockCycles(chunk);
+                remaining -= chunk;
+            }
+
+            stats.machineLaneSteps += machine.getTotalCpuCycles() - before;
+        }
+    }
+
+    void Batch::step(const std::uint64_t count)
+    {
+        std::uint64_t i = 0;
+
+        for (; i < count && lockstep; i++) {
+            executeClockCycle();
+
+            // Scattered lanes gain nothing from sharing a cycle
+            if (scatteredCycles == maxScatteredCycles) {
+                splitIntoMachines();
+            }
+        }
+
+        if (i < count) {
+            stepMachines(count - i);
+        }
+    }
+
+    void Batch::processCommand(const std::size_t lane, const c8::cpu::Command& command)
+    {
+        // The keypad lives in the machine, everything else changes how the
+        // lane runs, which only its own machine can do
+        if (command.type != c8::cpu::CommandType::KeyDown && command.type != c8::cpu::CommandType::KeyUp) {
+            splitIntoMachines();
+        }
+
+        machines[lane].processCommand(command);
+    }
+
+    std::size_t Batch::getLaneCount() const
+    {
+        return laneCount;
+    }
+
+    const c8::Machine& Batch::syncMachine(const std::size_t lane)
+    {
+        if (lockstep) {
+            syncLane(lane);
+        }
+
+        return machines[lane];
+    }
+
+    const Stats& Batch::getStats() const
+    {
+        return stats;
+    }
+
+    bool Batch::isUsingAvx2() const
+    {
+        return useAvx2;
+    }
+
+    bool Batch::isLockstep() const
+    {
+        return lockstep;
+    }
+}
@@ -0,0 +1,178 @@
+/**
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <istream>
+#include <string>
+#include <vector>
+
+#include "cpu.hpp"
+#include "machine.hpp"
+
+namespace c8::lockstep
+{
+    // Lanes per AVX2 register of 8 bit values, lane counts are padded to it
+    inline constexpr std::size_t lanesPerBlock = 32;
+
+    // Cycles in a row the lanes may stay scattered before the batch splits
+    // up into its machines
+    inline constexpr int maxScatteredCycles = 256;
+
+    struct Stats
+    {
+        // Instructions executed for one lane by the vector path
+        std::uint64_t vectorLaneSteps = 0;
+
+        // Instructions executed for one lane by the CpuState handlers
+        std::uint64_t scalarLaneSteps = 0;
+
+        // Sets of lanes that shared a pc and an opcode word in some cycle
+        std::uint64_t groups = 0;
+
+        // Instructions executed for one lane by its own Machine, after the
+        // batch split up
+        std::uint64_t machineLaneSteps = 0;
+    };
+
+    /**
+     * Runs many copies of one ROM side by side, one lane per copy. The
+     * registers of every lane are stored as arrays, and every cycle the
+     * lanes that sit at the same pc with the same word in memory execute
+     * it together with AVX2 when the CPU supports it. Instructions that
+     * touch memory, the display, the keypad or the random number generator,
+     * lanes that have diverged, and CPUs without AVX2 go through the
+     * CpuState handlers one lane at a time, so every lane behaves exactly
+     * like a c8::Machine run on its own.
+     *
+     * Without AVX2 every Machine runs on its own from the start. With it,
+     * the batch splits up once the lanes stay scattered for
+     * maxScatteredCycles cycles in a row, or once a lane is paused, stepped
+     * or given a breakpoint: every lane's state goes back into its Machine,
+     * and from then on each Machine runs on its own.
+    */
+    class Batch
+    {
+    private:
+        std::size_t laneCount;
+        std::size_t paddedLaneCount;
+
+        // Memory, display, keypad and random state of each lane. Their
+        // CpuState is only up to date after syncMachine.
+        std::deque<c8::Machine> machines;
+
+        // Memory as loaded. Lanes that have never written to memory still
+        // hold exactly this, so their words need not be fetched one by one.
+        std::array<std::uint8_t, c8::mem::maxBufferSize> program;
+        std::vector<std::uint8_t> dirty;
+        std::size_t dirtyLaneCount = 0;
+
+        std::vector<std::uint16_t> pc;
+        std::vector<std::uint16_t> ir;
+        std::vector<std::uint8_t> dt;
+        std::vector<std::uint8_t> st;
+        std::vector<std::uint8_t> sp;
+        std::vector<std::uint8_t> v[16];
+        std::vector<std::array<std::uint16_t, c8::cpu::maxStackDepth>> stack;
+
+        // Scratch space for one cycle
+        std::vector<std::uint16_t> words;
+        std::vector<std::uint8_t> pending;
+        std::vector<std::uint8_t> mask;
+
+        // Cycles run in lockstep, and per lane how many of them hit a zero
+        // word, which Machine does not count as executed
+        std::uint64_t cycles = 0;
+        std::vector<std::uint64_t> idleCycles;
+
+        int timerCycles = 0;
+        int scatteredCycles = 0;
+        bool useAvx2;
+        bool lockstep;
+
+        Stats stats;
+
+        void loadLane(const std::size_t lane, c8::cpu::CpuState& cpuState) const;
+
+        void storeLane(const std::size_t lane, const c8::cpu::CpuState& cpuState);
+
+        /**
+         * The word at the pc of lane, from its own memory once it has
+         * written to it
+        */
+        std::uint16_t fetchWord(const std::size_t lane) const;
+
+        void executeScalar(const std::size_t lane, const std::uint16_t word);
+
+        void executePendingScalar(const std::size_t first);
+
+        void advanceTimers();
+
+        void executeClockCycle();
+
+        /**
+         * Moves the registers, timer remainder and cycle count of lane into
+         * its machine
+        */
+        void syncLane(const std::size_t lane);
+
+        void splitIntoMachines();
+
+        void stepMachines(const std::uint64_t count);
+
+    public:
+        /**
+         * Loads rom into laneCount lanes, lane n gets the random seed
+         * firstSeed + n
+        */
+        Batch(const std::size_t laneCount, std::istream& rom, const std::uint32_t firstSeed);
+
+        Batch(const Batch&) = delete;
+        Batch& operator=(const Batch&) = delete;
+
+        void step(const std::uint64_t count);
+
+        /**
+         * Key commands keep the lanes in lockstep, pausing, stepping and
+         * breakpoints split the batch up first
+        */
+        void processCommand(const std::size_t lane, const c8::cpu::Command& command);
+
+        std::size_t getLaneCount() const;
+
+        /**
+         * Copies the state of lane into its machine and returns it
+        */
+        const c8::Machine& syncMachine(const std::size_t lane);
+
+        const Stats& getStats() const;
+
+        /**
+         * True if this CPU runs the vector path
+        */
+        bool isUsingAvx2() const;
+
+        /**
+         * False once the batch has split up into its machines
+        */
+        bool isLockstep() const;
+    };
+
+    bool cpuSupportsAvx2();
+}
@@ -0,0 +1,551 @@
+/**
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "machine.hpp"
+
+#include <algorithm>
+
+#include "callgraph.hpp"
+#include "config.hpp"
+#include "heatmap.hpp"
+#include "trace.hpp"
+
+namespace c8
+{
+    Machine::Machine(
+        const std::size_t historyDepth,
+        const std::uint32_t seed,
+        const bool cacheDisassembly) :
+        history(historyDepth),
+        randomState(seed)
+    {
+        if (cacheDisassembly) {
+            disassembly = std::make_unique<c8::disassembly::Cache>(memory);
+            memory.setDisassembly(disassembly.get());
+        }
+
+        memory.initialize();
+
+        initialize();
+    }
+
+    Machine::Machine(const Machine& other) :
+        ownCpuState(*other.cpuState),
+        ownVgaState(*other.vgaState),
+        memory(other.memory),
+        randomState(other.randomState),
+        cpuHertz(other.cpuHertz),
+        timerCycles(other.timerCycles),
+        totalCpuCycles(other.totalCpuCycles),
+        invalidOpcodeCount(other.invalidOpcodeCount),
+        firstInvalidOpcodeAddress(other.firstInvalidOpcodeAddress),
+        paused(other.paused),
+        waitingForKeyboard(other.waitingForKeyboard),
+        keyboardPressedValue(other.keyboardPressedValue),
+        keypad(other.keypad),
+        breakpoints(other.breakpoints),
+        breakpointCycle(other.breakpointCycle)
+    {
+        memory.setDisassembly(nullptr);
+    }
+
+    std::unique_ptr<Machine> Machine::clone() const
+    {
+        return std::unique_ptr<Machine>(new Machine(*this));
+    }
+
+    void Machine::initialize()
+    {
+        paused = false;
+        doAdvanceOneClockCycle = false;
+        waitingForKeyboard = false;
+        keyboardPressedValue = 0xFF;
+        keypad = 0;
+
+        reset();
+    }
+
+    void Machine::reset()
+    {
+        historyHead = 0;
+        historyCount = 0;
+        rewindDepth = 0;
+        totalCpuCycles = 0;
+        breakpointCycle = std::numeric_limits<std::uint64_t>::max();
+        timerCycles = 0;
+        invalidOpcodeCount = 0;
+        firstInvalidOpcodeAddress = 0;
+
+        *cpuState = {};
+        cpuState->pc = 0x200;
+        vgaState->clear();
+
+        memory.reset();
+    }
+
+    void Machine::loadProgram(std::istream& file)
+    {
+        memory.loadProgram(file);
+
+        reset();
+    }
+
+    bool Machine::loadProgram(const std::uint8_t* data, const std::size_t size)
+    {
+        if (!memory.loadProgram(data, size)) {
+            return false;
+        }
+
+        reset();
+
+        return true;
+    }
+
+    void Machine::saveState(SavedState& state) const
+    {
+        state.cpuState = *cpuState;
+        state.vgaState = *vgaState;
+
+        memory.copyTo(state.memory.data());
+
+        state.randomState = randomState;
+        state.totalCpuCycles = totalCpuCycles;
+        state.invalidOpcodeCount = invalidOpcodeCount;
+        state.timerCycles = timerCycles;
+        state.keypad = keypad;
+        state.firstInvalidOpcodeAddress = firstInvalidOpcodeAddress;
+        state.keyboardPressedValue = keyboardPressedValue;
+        state.waitingForKeyboard = waitingForKeyboard;
+    }
+
+    void Machine::restoreState(const SavedState& state)
+    {
+        *cpuState = state.cpuState;
+        *vgaState = state.vgaState;
+
+        memory.restore(state.memory.data());
+
+        randomState = state.randomState;
+        totalCpuCycles = state.totalCpuCycles;
+        invalidOpcodeCount = state.invalidOpcodeCount;
+        timerCycles = state.timerCycles;
+        keypad = state.keypad;
+        firstInvalidOpcodeAddress = state.firstInvalidOpcodeAddress;
+        keyboardPressedValue = state.keyboardPressedValue;
+        waitingForKeyboard = state.waitingForKeyboard;
+
+        historyHead = 0;
+        historyCount = 0;
+        rewindDepth = 0;
+    }
+
+    void Machine::setCpuFrequency(int hz)
+    {
+        cpuHertz = hz;
+    }
+
+    void Machine::togglePaused()
+    {
+        paused = !paused;
+    }
+
+    bool Machine::isPaused() const
+    {
+        return paused;
+    }
+
+    void Machine::advanceOneClockCycle()
+    {
+        if (!paused) {
+            return;
+        }
+
+        doAdvanceOneClockCycle = true;
+    }
+
+    void Machine::backOneClockCycle()
+    {
+        if (!paused) {
+            return;
+        }
+
+        if (rewindDepth < historyCount) {
+            rewindDepth++;
+        }
+    }
+
+    void Machine::keyboardKeyPressed(std::uint8_t value)
+    {
+        if (!waitingForKeyboard) {
+            return;
+        }
+
+        keyboardPressedValue = value;
+    }
+
+    void Machine::setKeypad(const std::uint16_t keys)
+    {
+        const std::uint16_t pressed = keys & ~keypad;
+
+        keypad = keys;
+
+        for (std::uint8_t key = 0; key <= 0xF; key++) {
+            if (pressed & (1 << key)) {
+                keyboardKeyPressed(key);
+            }
+        }
+    }
+
+    void Machine::processCommand(const c8::cpu::Command& command)
+    {
+        switch (command.type) {
+        case c8::cpu::CommandType::TogglePaused:
+            togglePaused();
+            break;
+        case c8::cpu::CommandType::Step:
+            advanceOneClockCycle();
+            break;
+        case c8::cpu::CommandType::StepBack:
+            backOneClockCycle();
+            break;
+        case c8::cpu::CommandType::KeyDown:
+            keypad |= 1 << command.key;
+            keyboardKeyPressed(command.key);
+            break;
+        case c8::cpu::CommandType::KeyUp:
+            keypad &= ~(1 << command.key);
+            break;
+        case c8::cpu::CommandType::ToggleBreakpoint:
+            breakpoints.toggle(command.address);
+            break;
+        }
+    }
+
+    const Machine::HistoryEntry* Machine::getRewoundEntry() const
+    {
+        if (rewindDepth == 0) {
+            return nullptr;
+        }
+
+        const std::size_t index = (historyHead + history.size() - rewindDepth) % history.size();
+
+        return &history[index];
+    }
+
+    void Machine::takeSnapshot(c8::cpu::Snapshot& snapshot) const
+    {
+        const HistoryEntry* entry = getRewoundEntry();
+
+        const c8::cpu::CpuState& shownCpuState = entry ? entry->cpuState : *cpuState;
+
+        snapshot.vgaState = entry ? entry->vgaState : *vgaState;
+        snapshot.pc = shownCpuState.pc;
+        snapshot.ir = shownCpuState.ir;
+        snapshot.dt = shownCpuState.dt;
+        snapshot.st = shownCpuState.st;
+        snapshot.v = shownCpuState.v;
+        snapshot.paused = paused;
+        snapshot.cpuStateDisplayIndex = static_cast<int>(historyCount - rewindDepth);
+        snapshot.cpuHertz = cpuHertz;
+
+        memory.fillListing(shownCpuState.pc, snapshot.memoryListing, breakpoints);
+    }
+
+    void Machine::decrementTimers()
+    {
+        if (cpuState->dt > 0) {
+            cpuState->dt--;
+        }
+
+        if (cpuState->st > 0) {
+            cpuState->st--;
+        }
+    }
+
+    // DT and ST count down at config::timerFrequency in emulated time, i.e.
+    // once every targetCpuFrequency / timerFrequency executed cycles. The
+    // remainder is carried so no fraction of a tick is lost.
+    void Machine::advanceTimers()
+    {
+        timerCycles += c8::config::timerFrequency;
+
+        if (timerCycles < c8::config::targetCpuFrequency) {
+            return;
+        }
+
+        timerCycles -= c8::config::targetCpuFrequency;
+
+        decrementTimers();
+    }
+
+    void Machine::executeClockCycle()
+    {
+        c8::counters::NoCounters counters;
+
+        executeClockCycle(counters);
+    }
+
+    // Policies that need the state after an instruction, such as the
+    // trace recorder, also get it
+    template <typename Counters>
+    void Machine::reportBeforeExecute(Counters& counters, const std::uint16_t word) const
+    {
+        if constexpr (requires { counters.beforeExecute(*cpuState, word); }) {
+            counters.beforeExecute(*cpuState, word);
+        }
+    }
+
+    template <typename Counters>
+    void Machine::reportExecuted(Counters& counters) const
+    {
+        if constexpr (requires { counters.executed(*cpuState); }) {
+            counters.executed(*cpuState);
+        }
+    }
+
+    template <typename Counters>
+    void Machine::executeClockCycle(Counters& counters)
+    {
+        if (paused && !doAdvanceOneClockCycle) {
+            return;
+        }
+
+        doAdvanceOneClockCycle = false;
+
+        // While showing a past state, advancing by 1 clock cycle just moves
+        // forward through the history until the live state is reached
+        if (rewindDepth > 0) {
+            rewindDepth--;
+
+            return;
+        }
+
+        const std::uint16_t opcode = memory.readWord(cpuState->pc);
+
+        if (opcode == 0x0) {
+            advanceTimers();
+            return;
+        }
+
+        totalCpuCycles++;
+
+        counters.count(cpuState->pc, opcode);
+
+        reportBeforeExecute(counters, opcode);
+
+        if (history.empty()) {
+            cpuState->execute(*this, opcode);
+            reportExecuted(counters);
+            advanceTimers();
+            return;
+        }
+
+        HistoryEntry& entry = history[historyHead];
+
+        entry.cpuState = *cpuState;
+        entry.vgaState = *vgaState;
+
+        const bool didUpdate = cpuState->execute(*this, opcode);
+
+        reportExecuted(counters);
+
+        // If executing the instruction didn't result in any changes to the
+        // cpu state, we do not need to keep the previous one in our history.
+        if (didUpdate) {
+            historyHead = historyHead + 1 == history.size() ? 0 : historyHead + 1;
+            historyCount = historyCount == history.size() ? historyCount : historyCount + 1;
+        }
+
+        advanceTimers();
+    }
+
+    template void Machine::executeClockCycle(c8::counters::NoCounters& counters);
+    template void Machine::executeClockCycle(c8::counters::InstructionCounters& counters);
+    template void Machine::executeClockCycle(c8::callgraph::Profiler& counters);
+    template void Machine::executeClockCycle(c8::trace::Recorder& counters);
+    template void Machine::executeClockCycle(c8::heatmap::AccessCounters& counters);
+
+    int Machine::executeClockCycles(const int count)
+    {
+        c8::counters::NoCounters counters;
+
+        return executeClockCycles(count, counters);
+    }
+
+    template <typename Counters>
+    int Machine::executeClockCycles(const int count, Counters& counters)
+    {
+        // The usual case gets a loop without any breakpoint check at all
+        if (breakpoints.isEmpty()) {
+            for (int i = 0; i < count; i++) {
+                executeClockCycle(counters);
+            }
+
+            return count;
+        }
+
+        for (int i = 0; i < count; i++) {
+            // Single steps are already paused and always run
+            if (!paused && totalCpuCycles != breakpointCycle && breakpoints.contains(cpuState->pc)) {
+                paused = true;
+                breakpointCycle = totalCpuCycles;
+                return i;
+            }
+
+            executeClockCycle(counters);
+        }
+
+        return count;
+    }
+
+    template int Machine::executeClockCycles(const int count, c8::counters::NoCounters& counters);
+    template int Machine::executeClockCycles(const int count, c8::counters::InstructionCounters& counters);
+    template int Machine::executeClockCycles(const int count, c8::callgraph::Profiler& counters);
+    template int Machine::executeClockCycles(const int count, c8::trace::Recorder& counters);
+    template int Machine::executeClockCycles(const int count, c8::heatmap::AccessCounters& counters);
+
+    bool Machine::isKeyDown(const std::uint8_t key) const
+    {
+        return key <= 0xF && (keypad & (1 << key)) != 0;
+    }
+
+    bool Machine::waitForKey(std::uint8_t& key)
+    {
+        waitingForKeyboard = true;
+
+        if (keyboardPressedValue == 0xFF) {
+            return false;
+        }
+
+        key = keyboardPressedValue;
+
+        keyboardPressedValue = 0xFF;
+        waitingForKeyboard = false;
+
+        return true;
+    }
+
+    // splitmix64, written out instead of std::uniform_int_distribution,
+    // whose results differ between standard libraries. RND takes the top
+    // byte, the best mixed one.
+    std::uint8_t Machine::nextRandom()
+    {
+        randomState += 0x9E3779B97F4A7C15;
+
+        std::uint64_t z = randomState;
+
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EB;
+        z = z ^ (z >> 31);
+
+        return static_cast<std::uint8_t>(z >> 56);
+    }
+
+    void Machine::reportInvalidOpcode(const std::uint16_t addr)
+    {
+        if (invalidOpcodeCount == 0) {
+            firstInvalidOpcodeAddress = addr;
+        }
+
+        invalidOpcodeCount++;
+    }
+
+    std::uint64_t Machine::getInvalidOpcodeCount() const
+    {
+        return invalidOpcodeCount;
+    }
+
+    std::uint16_t Machine::getFirstInvalidOpcodeAddress() const
+    {
+        return firstInvalidOpcodeAddress;
+    }
+
+    std::uint64_t Machine::getTotalCpuCycles() const
+    {
+        return totalCpuCycles;
+    }
+
+    c8::cpu::CpuState& Machine::getCpuState()
+    {
+        return *cpuState;
+    }
+
+    const c8::cpu::CpuState& Machine::getCpuState() const
+    {
+        return *cpuState;
+    }
+
+    c8::vga::VgaState& Machine::getVgaState()
+    {
+        return *vgaState;
+    }
+
+    const c8::vga::VgaState& Machine::getVgaState() const
+    {
+        return *vgaState;
+    }
+
+    void Machine::attachVgaState(c8::vga::VgaState* storage)
+    {
+        c8::vga::VgaState* target = storage != nullptr ? storage : &ownVgaState;
+
+        if (target != vgaState) {
+            *target = *vgaState;
+            vgaState = target;
+        }
+    }
+
+    void Machine::attachCpuState(c8::cpu::CpuState* storage)
+    {
+        c8::cpu::CpuState* target = storage != nullptr ? storage : &ownCpuState;
+
+        if (target != cpuState) {
+            *target = *cpuState;
+            cpuState = target;
+        }
+    }
+
+    c8::breakpoints::Bitmap& Machine::getBreakpoints()
+    {
+        return breakpoints;
+    }
+
+    const c8::breakpoints::Bitmap& Machine::getBreakpoints() const
+    {
+        return breakpoints;
+    }
+
+    c8::mem::Memory& Machine::getMemory()
+    {
+        return memory;
+    }
+
+    const c8::mem::Memory& Machine::getMemory() const
+    {
+        return memory;
+    }
+
+    c8::disassembly::Cache* Machine::getDisassembly()
+    {
+        return disassembly.get();
+    }
+
+    Machine& defaultMachine()
+    {
+        static Machine machine{c8::cpu::maxCpuStates, std::random_device{}(), true};
+
+        return machine;
+    }
+}
@@ -0,0 +1,297 @@
+/**
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <istream>
+#include <limits>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "counters.hpp"
+#include "cpu.hpp"
+#include "breakpoints.hpp"
+#include "memory.hpp"
+#include "vga.hpp"
+#include "disassembly.hpp"
+
+namespace c8
+{
+    /**
+     * One complete CHIP-8 machine: CPU, memory, display, keypad, random
+     * number generator and rewind history. Machines share no state, so any
+     * number of them can run in the same process, each on its own thread.
+    */
+    class Machine
+    {
+    public:
+        /**
+         * Everything needed to put a machine back exactly where it was, apart
+         * from its history. Trivially copyable, so it can be stored as bytes.
+        */
+        struct SavedState
+        {
+            c8::cpu::CpuState cpuState;
+            c8::vga::VgaState vgaState;
+
+            std::array<std::uint8_t, c8::mem::maxBufferSize> memory;
+
+            std::uint64_t randomState;
+            std::uint64_t totalCpuCycles;
+            std::uint64_t invalidOpcodeCount;
+
+            int timerCycles;
+
+            std::uint16_t keypad;
+            std::uint16_t firstInvalidOpcodeAddress;
+
+            std::uint8_t keyboardPressedValue;
+            bool waitingForKeyboard;
+        };
+
+    private:
+        // State of the machine before an executed instruction
+        struct HistoryEntry
+        {
+            c8::cpu::CpuState cpuState;
+            c8::vga::VgaState vgaState;
+        };
+
+        c8::cpu::CpuState ownCpuState{};
+        c8::vga::VgaState ownVgaState{};
+
+        // Point at the members above unless storage elsewhere was attached
+        c8::cpu::CpuState* cpuState = &ownCpuState;
+        c8::vga::VgaState* vgaState = &ownVgaState;
+        c8::mem::Memory memory;
+
+        std::unique_ptr<c8::disassembly::Cache> disassembly;
+
+        // Ring of past states, historyHead is the next slot to write and
+        // rewindDepth how many entries back from the live state is shown
+        std::vector<HistoryEntry> history;
+        std::size_t historyHead = 0;
+        std::size_t historyCount = 0;
+        std::size_t rewindDepth = 0;
+
+        // splitmix64 state, 8 bytes instead of the 5 KB of an mt19937 so
+        // that thousands of machines stay small
+        std::uint64_t randomState;
+
+        int cpuHertz = 0;
+        int timerCycles = 0;
+        std::uint64_t totalCpuCycles = 0;
+
+        std::uint64_t invalidOpcodeCount = 0;
+        std::uint16_t firstInvalidOpcodeAddress = 0;
+
+        bool paused = false;
+        bool doAdvanceOneClockCycle = false;
+        bool waitingForKeyboard = false;
+
+        std::uint8_t keyboardPressedValue = 0xFF;
+
+        // One bit per key, bit n set while key n is held down
+        std::uint16_t keypad = 0;
+
+        c8::breakpoints::Bitmap breakpoints;
+
+        // totalCpuCycles when the last breakpoint stopped the machine. While
+        // nothing has run since, the breakpoint at the PC is not checked
+        // again, so resuming runs the instruction there.
+        std::uint64_t breakpointCycle = std::numeric_limits<std::uint64_t>::max();
+
+        const HistoryEntry* getRewoundEntry() const;
+
+        void decrementTimers();
+
+        void advanceTimers();
+
+        template <typename Counters>
+        void reportBeforeExecute(Counters& counters, const std::uint16_t word) const;
+
+        template <typename Counters>
+        void reportExecuted(Counters& counters) const;
+
+        /**
+         * Used by clone, shares the memory pages of other
+        */
+        Machine(const Machine& other);
+
+    public:
+        /**
+         * historyDepth is the number of past states kept for stepping back,
+         * 0 disables the history entirely. The disassembly cache is only
+         * needed by machines whose memory listing is displayed.
+        */
+        explicit Machine(
+            const std::size_t historyDepth = c8::cpu::maxCpuStates,
+            const std::uint32_t seed = std::random_device{}(),
+            const bool cacheDisassembly = false);
+
+        Machine& operator=(const Machine&) = delete;
+
+        /**
+         * A machine in exactly the live state of this one, without its
+         * history or disassembly cache. Memory pages are shared and only
+         * copied by whichever machine writes to them first, so a clone that
+         * touches little memory costs little more than its registers and
+         * frame buffer.
+        */
+        std::unique_ptr<Machine> clone() const;
+
+        /**
+         * Clears the pause and keyboard state, then resets the machine
+        */
+        void initialize();
+
+        /**
+         * Restores memory to the loaded program and starts again at 0x200
+        */
+        void reset();
+
+        void loadProgram(std::istream& file);
+
+        /**
+         * Returns false if the program does not fit in memory
+        */
+        bool loadProgram(const std::uint8_t* data, const std::size_t size);
+
+        void saveState(SavedState& state) const;
+
+        /**
+         * Also forgets the history, it belongs to the state being replaced
+        */
+        void restoreState(const SavedState& state);
+
+        void setCpuFrequency(int hz);
+
+        void togglePaused();
+
+        bool isPaused() const;
+
+        void advanceOneClockCycle();
+
+        void backOneClockCycle();
+
+        void keyboardKeyPressed(std::uint8_t value);
+
+        /**
+         * Sets every key at once, bit n set means key n is held down. Keys
+         * that were up before count as pressed for Fx0A.
+        */
+        void setKeypad(const std::uint16_t keys);
+
+        void processCommand(const c8::cpu::Command& command);
+
+        void takeSnapshot(c8::cpu::Snapshot& snapshot) const;
+
+        /**
+         * Executes one instruction. DT and ST are also advanced here, so the
+         * timers only depend on how many cycles ran, not on the host frame rate.
+        */
+        void executeClockCycle();
+
+        /**
+         * Runs count clock cycles, pausing when the PC reaches a breakpoint
+         * so the instruction there has not run yet. Returns the number of
+         * cycles gone through, less than count only when it stopped at a
+         * breakpoint. Without breakpoints this is a plain loop over
+         * executeClockCycle. Clones keep the breakpoints of the original.
+        */
+        int executeClockCycles(const int count);
+
+        template <typename Counters>
+        int executeClockCycles(const int count, Counters& counters);
+
+        /**
+         * Same as executeClockCycle, and reports each executed instruction
+         * to counters with count(pc, word). A policy can also have
+         * beforeExecute(state, word) and executed(state), which see the CPU
+         * state just before and after the instruction. Instantiated for the
+         * policies in counters, callgraph, trace and heatmap.
+        */
+        template <typename Counters>
+        void executeClockCycle(Counters& counters);
+
+        bool isKeyDown(const std::uint8_t key) const;
+
+        /**
+         * Called by Fx0A, returns true and the key once one has been pressed
+         * since the machine started waiting
+        */
+        bool waitForKey(std::uint8_t& key);
+
+        std::uint8_t nextRandom();
+
+        /**
+         * Called when the word at addr does not decode to an instruction.
+         * The pc does not move past it, so a program that hits one is stuck.
+        */
+        void reportInvalidOpcode(const std::uint16_t addr);
+
+        /**
+         * Number of cycles spent on invalid opcodes since the last reset
+        */
+        std::uint64_t getInvalidOpcodeCount() const;
+
+        std::uint16_t getFirstInvalidOpcodeAddress() const;
+
+        std::uint64_t getTotalCpuCycles() const;
+
+        c8::cpu::CpuState& getCpuState();
+
+        const c8::cpu::CpuState& getCpuState() const;
+
+        c8::vga::VgaState& getVgaState();
+
+        const c8::vga::VgaState& getVgaState() const;
+
+        /**
+         * Moves the frame buffer into storage, which must outlive the machine
+         * or be detached again with nullptr. Lets the frame buffers of many
+         * machines sit next to each other, see c8::arena.
+        */
+        void attachVgaState(c8::vga::VgaState* storage);
+
+        /**
+         * Same as attachVgaState, for the registers
+        */
+        void attachCpuState(c8::cpu::CpuState* storage);
+
+        c8::breakpoints::Bitmap& getBreakpoints();
+
+        const c8::breakpoints::Bitmap& getBreakpoints() const;
+
+        c8::mem::Memory& getMemory();
+
+        const c8::mem::Memory& getMemory() const;
+
+        /**
+         * nullptr unless the machine was created with cacheDisassembly
+        */
+        c8::disassembly::Cache* getDisassembly();
+    };
+
+    /**
+     * The machine driven by the emulator window and by the free functions
+     * in c8::cpu, c8::mem and c8::disassembly
+    */
+    Machine& defaultMachine();
+}
@@ -21,14 +21,73 @@
 #include <thread>
 #include <memory>
 #include <sstream>
+#include <atomic>
+#include <type_traits>
 
 #include <SFML/Graphics.hpp>
 
 #include "cpu.hpp"
+#include "machine.hpp"
+#include "counters.hpp"
+#include "trace.hpp"
+#include "heatmap.hpp"
 #include "memory.hpp"
 #include "vga.hpp"
 #include "config.hpp"
 #include "ui.hpp"
+#include "disassembly.hpp"
+#include "sync.hpp"
+#include "pacing.hpp"
+#include "allocations.hpp"
+#include "phases.hpp"
+#include "perf.hpp"
+#include "headless.hpp"
+
+c8::sync::TripleBuffer<c8::cpu::Snapshot> snapshots;
+c8::cpu::CommandQueue commands;
+
+std::atomic<bool> running{true};
+
+// When vsync locked, the emulation thread runs one frame per frame presented
+// by the render thread instead of keeping its own time
+bool vsyncLocked = false;
+std::atomic<std::uint64_t> presentedFrames{0};
+
+bool frameSkip = false;
+
+using Counters = std::conditional_t<
+    c8::config::countInstructions,
+    c8::counters::InstructionCounters,
+    c8::counters::NoCounters>;
+
+// Only touched by the emulation thread until it has been joined
+Counters counters;
+
+// Written on exit when given with --counters
+std::string countersPath;
+
+// With --trace, every instruction is recorded instead of counted
+std::string tracePath;
+std::unique_ptr<c8::trace::Recorder> traceRecorder;
+std::unique_ptr<c8::trace::Writer> traceWriter;
+
+// With --heatmap, memory accesses are counted instead of instructions and
+// written on exit
+std::string heatmapPath;
+std::unique_ptr<c8::heatmap::AccessCounters> accessCounters;
+
+// Each thread times its own phases, both are only read by main once the
+// emulation thread has been joined
+c8::phases::Recorder emulationPhases{1};
+c8::phases::Recorder renderPhases{2};
+
+// With --phase-trace, the phases of the last phaseTraceFrames frames are
+// written on exit as Chrome trace event JSON
+std::string phaseTracePath;
+std::size_t phaseTraceFrames = 600;
+
+// With --perf, hardware counters are read around every frame's execute loop
+bool perfCounters = false;
 
 void processArgs(int argc, char** argv)
 {
@@ -40,12 +99,68 @@ void processArgs(int argc, char** argv)
 
     args.assign(argv + 1, argv + argc);
 
-    for (const auto& arg : args) {
+    std::string disassemblyPath;
+
+    for (std::size_t i = 0; i < args.size(); i++) {
+        const std::string& arg = args[i];
+
         if (arg == "-p") {
             c8::cpu::togglePaused();
             continue;
         }
 
+        if (arg == "--vsync") {
+            vsyncLocked = true;
+            continue;
+        }
+
+        if (arg == "--frame-skip") {
+            frameSkip = true;
+            continue;
+        }
+
+        if (arg == "--counters" && i + 1 < args.size()) {
+            countersPath = args[++i];
+            continue;
+        }
+
+        if (arg == "--trace" && i + 1 < args.size()) {
+            tracePath = args[++i];
+            continue;
+        }
+
+        if (arg == "--break" && i + 1 < args.size()) {
+            const auto addr = static_cast<std::uint16_t>(std::stoul(args[++i], nullptr, 16));
+
+            c8::defaultMachine().getBreakpoints().set(addr, true);
+            continue;
+        }
+
+        if (arg == "--heatmap" && i + 1 < args.size()) {
+            heatmapPath = args[++i];
+            continue;
+        }
+
+        if (arg == "--perf") {
+            perfCounters = true;
+            continue;
+        }
+
+        if (arg == "--phase-trace" && i + 1 < args.size()) {
+            phaseTracePath = args[++i];
+            continue;
+        }
+
+        if (arg == "--phase-trace-frames" && i + 1 < args.size()) {
+            phaseTraceFrames = std::stoul(args[++i]);
+            continue;
+        }
+
+        if (arg == "-d" && i + 1 < args.size()) {
+            disassemblyPath = args[++i];
+            continue;
+        }
+
         std::ifstream file{arg};
 
         if (file.is_open()) {
@@ -54,65 +169,323 @@ void processArgs(int argc, char** argv)
 
         file.close();
     }
+
+    if (!disassemblyPath.empty()) {
+        std::ofstream out{disassemblyPath};
+
+        c8::disassembly::exportAll(out);
+    }
 }
 
-void loop()
+void emulationLoop()
 {
-    using clock = std::chrono::high_resolution_clock;
+    using clock = c8::pacing::clock;
+
+    c8::pacing::FramePacer pacer{c8::config::targetHostFps};
+    c8::pacing::CatchUpScheduler scheduler{c8::config::targetCpuFrequency, c8::config::targetHostFps};
+
+    std::uint64_t presentedFrame = presentedFrames.load();
 
     int clockCycles = 0;
-    int frames = 0;
+    int skippedFrames = 0;
+    std::uint64_t totalSkippedFrames = 0;
+
+    // Opened here because the counters count the thread that opens them
+    std::unique_ptr<c8::perf::CounterGroup> hostCounters;
+
+    c8::perf::Sample hostSample;
+    int hostSampleCycles = 0;
+
+    if (perfCounters) {
+        hostCounters = std::make_unique<c8::perf::CounterGroup>();
+
+        if (!hostCounters->isAvailable()) {
+            std::cerr << "Hardware performance counters are not available\n";
+
+            hostCounters.reset();
+        }
+    }
+
+    // Only ever counted when built with C8_TRACK_ALLOCATIONS
+    c8::allocations::Counts frameStartAllocations = c8::allocations::getThreadCounts();
+    c8::allocations::Counts frameAllocations;
+    c8::allocations::Counts executeAllocations;
+    std::uint64_t executedCycles = 0;
 
     auto lastFpsUpdate = clock::now();
+    auto lastFrameStart = clock::now() - std::chrono::nanoseconds{1'000'000'000 / c8::config::targetHostFps};
 
-    while (c8::ui::isOpen()) {
-        const auto start = clock::now();
+    while (running.load(std::memory_order_relaxed)) {
+        const auto frameStart = clock::now();
 
-        c8::ui::pollInput();
-        c8::cpu::decrementTimers();
+        const c8::allocations::Counts allocations = c8::allocations::getThreadCounts();
 
-        if (clockCycles < c8::config::targetCpuFrequency) {
-            auto cyclesThisFrame = c8::config::targetCpuCyclesPerFrame;
+        frameAllocations = allocations - frameStartAllocations;
+        frameStartAllocations = allocations;
 
-            if (frames == c8::config::targetHostFps - 1) {
-                cyclesThisFrame = c8::config::targetCpuFrequency - clockCycles;
-            }
+        c8::cpu::Command command;
+
+        while (commands.pop(command)) {
+            c8::cpu::processCommand(command);
+        }
+
+        const auto executeStart = clock::now();
+
+        emulationPhases.record(c8::phases::Phase::Commands, frameStart, executeStart);
+
+        const int cyclesThisFrame = scheduler.cyclesForFrame(frameStart - lastFrameStart);
+
+        lastFrameStart = frameStart;
+
+        const c8::allocations::Counts executeStartAllocations = c8::allocations::getThreadCounts();
+
+        if (hostCounters != nullptr) {
+            hostCounters->start();
+        }
 
-            for (int cycles = 0; cycles < cyclesThisFrame; cycles++) {
-                c8::cpu::executeClockCycle();
+        const std::uint64_t cyclesBefore = c8::defaultMachine().getTotalCpuCycles();
 
-                clockCycles++;
+        // Stops early and pauses when a breakpoint is reached
+        if (traceRecorder != nullptr) {
+            c8::defaultMachine().executeClockCycles(cyclesThisFrame, *traceRecorder);
+        } else if (accessCounters != nullptr) {
+            c8::defaultMachine().executeClockCycles(cyclesThisFrame, *accessCounters);
+        } else {
+            c8::defaultMachine().executeClockCycles(cyclesThisFrame, counters);
+        }
+
+        // Less than scheduled while paused or stopped at a breakpoint
+        const int executedThisFrame = static_cast<int>(c8::defaultMachine().getTotalCpuCycles() - cyclesBefore);
+
+        if (hostCounters != nullptr) {
+            const c8::perf::Sample sample = hostCounters->stop();
+
+            if (executedThisFrame > 0) {
+                hostSample = sample;
+                hostSampleCycles = executedThisFrame;
             }
         }
 
-        c8::ui::draw();
+        emulationPhases.record(c8::phases::Phase::Execute, executeStart, clock::now());
 
-        frames++;
+        const c8::allocations::Counts executeEndAllocations = c8::allocations::getThreadCounts();
+
+        executeAllocations.allocations += executeEndAllocations.allocations - executeStartAllocations.allocations;
+        executeAllocations.bytes += executeEndAllocations.bytes - executeStartAllocations.bytes;
+        executedCycles += executedThisFrame;
+
+        clockCycles += executedThisFrame;
+
+        // While behind wall time, skipping the snapshot lets the render
+        // thread skip drawing too, but never for more than a few frames
+        if (frameSkip && scheduler.isBehind() && skippedFrames < c8::config::maxSkippedFrames) {
+            skippedFrames++;
+            totalSkippedFrames++;
+        } else {
+            const auto phase = emulationPhases.time(c8::phases::Phase::Snapshot);
+
+            skippedFrames = 0;
 
-        if (start - lastFpsUpdate >= std::chrono::seconds(1) || frames == c8::config::targetHostFps) {
+            c8::cpu::Snapshot& snapshot = snapshots.writeBuffer();
+
+            c8::cpu::takeSnapshot(snapshot);
+            snapshot.frameIntervalP50 = pacer.getIntervals().percentile(50);
+            snapshot.frameIntervalP99 = pacer.getIntervals().percentile(99);
+            snapshot.backlogCycles = scheduler.getBacklog();
+            snapshot.droppedCycles = scheduler.getDroppedCycles();
+            snapshot.caughtUpCycles = scheduler.getCaughtUpCycles();
+            snapshot.skippedFrames = totalSkippedFrames;
+            snapshot.countedInstructions = counters.getTotal();
+
+            counters.fillTop(snapshot.topOpcodes, snapshot.topAddresses);
+
+            snapshot.heatmapEnabled = accessCounters != nullptr;
+
+            if (accessCounters != nullptr) {
+                accessCounters->fillHeatmap(snapshot.heatmap);
+            }
+
+            emulationPhases.fillSummary(snapshot.emulationPhases);
+
+            snapshot.hostCounters = hostSample;
+            snapshot.hostCountersCycles = hostSampleCycles;
+            snapshot.emulationFrameAllocations = frameAllocations;
+            snapshot.executeAllocations = executeAllocations;
+            snapshot.executedCycles = executedCycles;
+
+            snapshots.publish();
+        }
+
+        const auto now = clock::now();
+
+        if (now - lastFpsUpdate >= std::chrono::seconds(1)) {
             c8::cpu::setCpuFrequency(clockCycles);
-            c8::cpu::setFps(frames);
 
             clockCycles = 0;
+            lastFpsUpdate = now;
+        }
+
+        const auto phase = emulationPhases.time(c8::phases::Phase::EmulationSleep);
+
+        if (vsyncLocked) {
+            presentedFrames.wait(presentedFrame);
+            presentedFrame = presentedFrames.load();
+
+            pacer.mark();
+        } else {
+            pacer.wait();
+        }
+    }
+}
+
+void renderLoop()
+{
+    using clock = c8::pacing::clock;
+
+    c8::pacing::FramePacer pacer{c8::config::targetHostFps};
+
+    int frames = 0;
+
+    c8::allocations::Counts frameStartAllocations = c8::allocations::getThreadCounts();
+
+    auto lastFpsUpdate = clock::now();
+
+    while (c8::ui::isOpen()) {
+        const c8::allocations::Counts allocations = c8::allocations::getThreadCounts();
+
+        c8::ui::setRenderAllocations(allocations - frameStartAllocations);
+
+        frameStartAllocations = allocations;
+
+        {
+            const auto phase = renderPhases.time(c8::phases::Phase::PollInput);
+
+            c8::ui::pollInput(commands);
+        }
+
+        const bool hasNewSnapshot = snapshots.update();
+
+        // Skipping a draw in vsync locked mode would also skip the vsync wait
+        // that paces both threads
+        if (hasNewSnapshot || !frameSkip || vsyncLocked) {
+            c8::ui::draw(snapshots.readBuffer(), renderPhases);
+        }
+
+        frames++;
+
+        const auto now = clock::now();
+
+        if (now - lastFpsUpdate >= std::chrono::seconds(1)) {
+            c8::ui::setFps(frames);
+
             frames = 0;
-            lastFpsUpdate = clock::now();
+            lastFpsUpdate = now;
         }
 
-        const auto end = clock::now();
+        const auto phase = renderPhases.time(c8::phases::Phase::RenderSleep);
 
-        if (end - start < c8::config::targetHostFpsRatio) {
-            std::this_thread::sleep_until(start + c8::config::targetHostFpsRatio);
+        if (vsyncLocked) {
+            presentedFrames.fetch_add(1);
+            presentedFrames.notify_one();
+        } else {
+            pacer.wait();
         }
     }
 }
 
 int main(int argc, char** argv)
 {
+    for (int i = 1; i < argc; i++) {
+        if (std::string{argv[i]} == "--headless") {
+            return c8::headless::run(argc, argv);
+        }
+    }
+
     c8::ui::initialize();
     c8::mem::initialize();
     c8::cpu::initialize();
 
     processArgs(argc, argv);
 
-    loop();
+    c8::defaultMachine().getMemory().unsharePages();
+
+    if (!tracePath.empty()) {
+        // The recorder replaces the instruction counters, so their CSV would be empty
+        if (!countersPath.empty()) {
+            std::cerr << "--trace and --counters cannot be used together\n";
+            return 1;
+        }
+
+        traceRecorder = std::make_unique<c8::trace::Recorder>();
+        traceWriter = std::make_unique<c8::trace::Writer>(*traceRecorder, tracePath);
+
+        if (!traceWriter->isOpen()) {
+            std::cerr << "Could not open " << tracePath << "\n";
+
+            traceWriter.reset();
+            traceRecorder.reset();
+        }
+    }
+
+    if (!heatmapPath.empty()) {
+        if (!tracePath.empty()) {
+            std::cerr << "--heatmap and --trace cannot be used together\n";
+            return 1;
+        }
+
+        if (!countersPath.empty()) {
+            std::cerr << "--heatmap and --counters cannot be used together\n";
+            return 1;
+        }
+
+        accessCounters = std::make_unique<c8::heatmap::AccessCounters>();
+    }
+
+    const auto phaseTraceOrigin = c8::phases::clock::now();
+
+    if (!phaseTracePath.empty()) {
+        emulationPhases.startCapture(phaseTraceFrames * c8::phases::phaseCount);
+        renderPhases.startCapture(phaseTraceFrames * c8::phases::phaseCount);
+    }
+
+    c8::ui::setVerticalSyncEnabled(vsyncLocked);
+
+    // The first snapshot is taken before the emulation thread starts so the
+    // render thread never draws an empty frame
+    c8::cpu::takeSnapshot(snapshots.writeBuffer());
+    snapshots.publish();
+
+    std::thread emulationThread{emulationLoop};
+
+    renderLoop();
+
+    running.store(false, std::memory_order_relaxed);
+
+    presentedFrames.fetch_add(1);
+    presentedFrames.notify_one();
+
+    emulationThread.join();
+
+    // Writes what is still queued and the final record count
+    traceWriter.reset();
+
+    if (!phaseTracePath.empty()) {
+        std::ofstream out{phaseTracePath};
+
+        c8::phases::writeChromeTrace(out, {&emulationPhases, &renderPhases}, phaseTraceOrigin);
+    }
+
+    if (accessCounters != nullptr) {
+        std::ofstream out{heatmapPath};
+
+        accessCounters->writeCsv(out);
+    }
+
+    if constexpr (Counters::enabled) {
+        if (!countersPath.empty()) {
+            std::ofstream out{countersPath};
+
+            counters.writeCsv(out);
+        }
+    }
 }
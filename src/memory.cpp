@@ -23,9 +23,10 @@
 #include <cstring>
 
 #include "vga.hpp"
-#include "cpu.hpp"
+#include "machine.hpp"
 #include "opcodes.hpp"
-#include "ui.hpp"
+#include "format.hpp"
+#include "disassembly.hpp"
 
 namespace c8::mem
 {
@@ -70,74 +71,69 @@ namespace c8::mem
     };
 
     constexpr int defaultProgramLength = sizeof(defaultProgram);
-    constexpr int maxBufferSize = 4096;
 
-    std::uint8_t buffer[maxBufferSize];
-    std::uint8_t originalBuffer[maxBufferSize];
-
-    void zeroMemory();
-
-    void writeSprite(const std::uint16_t addr, const std::uint8_t* sprite);
-
-    void writeSprites();
-
-    void reset()
+    void Memory::reset()
     {
-        std::memcpy(buffer, originalBuffer, maxBufferSize);
+        for (int i = 0; i < pageCount; i++) {
+            if (pages[i] == originalPages[i]) {
+                continue;
+            }
+
+            if (pages[i].use_count() == 1) {
+                *pages[i] = *originalPages[i];
+            } else {
+                pages[i] = originalPages[i];
+            }
+        }
+
+        if (disassembly != nullptr) {
+            disassembly->invalidateAll();
+        }
     }
 
-    void drawMemoryInfoLine(
-        std::stringstream& ss, 
+    void Memory::setMemoryInfoLine(
+        c8::format::Line& line,
         const std::uint16_t addr, 
-        const bool isCurrentAddr = false)
+        const bool isCurrentAddr,
+        const bool hasBreakpoint) const
     {
         const std::uint16_t word = readWord(addr);
 
-        if (isCurrentAddr) {
-            ss << " >";
+        line.clear()
+            .append(hasBreakpoint ? '*' : ' ')
+            .append(isCurrentAddr ? '>' : ' ')
+            .appendHex(addr, false).append('\t')
+            .appendHex(word, false).append('\t');
+
+        if (disassembly != nullptr) {
+            line.append(disassembly->get(addr));
         } else {
-            ss << "  ";
+            c8::opcodes::formatOpcodeName(word, line);
         }
-
-        ss << c8::ui::Hex{addr, false} << "\t"
-           << c8::ui::Hex{word, false} << "\t"
-           << c8::opcodes::getOpcodeName(word) << "\n";
     }
 
-    void render(sf::RenderTexture& texture)
+    void Memory::fillListing(
+        const std::uint16_t pc,
+        Listing& listing,
+        const c8::breakpoints::Bitmap& breakpoints) const
     {
-        const int linesAroundPc = 10;
-        const std::uint16_t pc = c8::cpu::getProgramCounter();
+        for (int i = 0; i < listingLineCount; i++) {
+            const std::uint16_t addr = getListingAddress(pc, i);
 
-        std::stringstream ss;
-
-        for (int i = 0; i < linesAroundPc; i++) {
-            const std::uint16_t addr = pc - (linesAroundPc * 2) + (i * 2);
-
-            drawMemoryInfoLine(ss, addr);
+            setMemoryInfoLine(listing[i], addr, i == linesAroundPc, breakpoints.contains(addr));
         }
-
-        drawMemoryInfoLine(ss, pc, true);
-
-        for (int i = 0; i < linesAroundPc; i++) {
-            const std::uint16_t addr = pc + (i * 2) + 2;
-
-            drawMemoryInfoLine(ss, addr);
-        }
-
-        c8::ui::drawText(texture, 0, 0, ss);
     }
 
-    std::uint8_t readByte(const std::uint16_t addr) 
+    std::uint8_t Memory::readByte(const std::uint16_t addr) const
     {
         if (addr >= maxBufferSize) {
             return 0;
         }
 
-        return buffer[addr];
+        return (*pages[addr / pageSize])[addr % pageSize];
     }
 
-    std::uint16_t readWord(const std::uint16_t addr)
+    std::uint16_t Memory::readWord(const std::uint16_t addr) const
     {
         if (addr >= maxBufferSize) {
             return 0;
@@ -149,16 +145,67 @@ namespace c8::mem
         return (highByte << 8) | lowByte;
     }
 
-    void writeByte(const int addr, const std::uint8_t data)
+    void Memory::writeByte(const int addr, const std::uint8_t data)
     {
         if (addr < 0 || addr >= maxBufferSize) {
             return;
         }
 
-        buffer[addr] = data;
+        getWritablePage(addr / pageSize)[addr % pageSize] = data;
+
+        if (disassembly != nullptr) {
+            disassembly->invalidate(addr);
+        }
+    }
+
+    Page& Memory::getWritablePage(const int index)
+    {
+        std::shared_ptr<Page>& page = pages[index];
+
+        if (page.use_count() != 1) {
+            page = std::make_shared<Page>(*page);
+        }
+
+        return *page;
+    }
+
+    void Memory::unsharePages()
+    {
+        for (int i = 0; i < pageCount; i++) {
+            getWritablePage(i);
+        }
     }
 
-    void writeSprite(const std::uint16_t addr, const std::uint8_t* sprite)
+    void Memory::writeBlock(const int addr, const std::uint8_t* data, const std::size_t size)
+    {
+        std::size_t written = 0;
+
+        while (written < size) {
+            const int offset = (addr + static_cast<int>(written)) % pageSize;
+            const int index = (addr + static_cast<int>(written)) / pageSize;
+            const std::size_t count = std::min<std::size_t>(pageSize - offset, size - written);
+
+            std::copy_n(data + written, count, getWritablePage(index).begin() + offset);
+
+            written += count;
+        }
+    }
+
+    void Memory::copyTo(std::uint8_t* data) const
+    {
+        for (int i = 0; i < pageCount; i++) {
+            std::copy_n(pages[i]->begin(), pageSize, data + i * pageSize);
+        }
+    }
+
+    int Memory::getSharedPageCount() const
+    {
+        return static_cast<int>(std::count_if(pages.begin(), pages.end(), [](const auto& page) {
+            return page.use_count() > 1;
+        }));
+    }
+
+    void Memory::writeSprite(const std::uint16_t addr, const std::uint8_t* sprite)
     {
         writeByte(addr, sprite[0]);
         writeByte(addr + 1, sprite[1]);
@@ -167,7 +214,7 @@ namespace c8::mem
         writeByte(addr + 4, sprite[4]);
     }
 
-    void writeSprites()
+    void Memory::writeSprites()
     {
         std::uint16_t addr = 0x0;
 
@@ -178,35 +225,124 @@ namespace c8::mem
         }
     }
 
-    void zeroMemory() 
+    void Memory::zeroMemory() 
     {
-        std::fill(buffer, buffer + maxBufferSize, 0);
+        for (auto& page : pages) {
+            page = std::make_shared<Page>();
+        }
     }
 
-    void loadDefaultProgram()
+    void Memory::loadDefaultProgram()
     {
-        std::memcpy(buffer + 0x200, defaultProgram, defaultProgramLength);
+        writeBlock(0x200, defaultProgram, defaultProgramLength);
     }
 
-    void initialize()
+    void Memory::initialize()
     {
         zeroMemory();
         writeSprites();
         loadDefaultProgram();
 
-        std::memcpy(originalBuffer, buffer, maxBufferSize);
+        originalPages = pages;
+
+        if (disassembly != nullptr) {
+            disassembly->invalidateAll();
+        }
     }
 
-    void loadProgram(std::ifstream& file)
+    void Memory::loadProgram(std::istream& file)
     {
         file.seekg(0, file.end);
 
-        int length = file.tellg();
+        const auto length = std::min<std::streamoff>(file.tellg(), maxBufferSize - 0x200);
+
+        std::array<std::uint8_t, maxBufferSize - 0x200> program;
 
         file.seekg(0, file.beg);
-        file.read((char*)buffer + 0x200, length);
+        file.read((char*)program.data(), length);
+
+        writeBlock(0x200, program.data(), static_cast<std::size_t>(file.gcount()));
+
+        originalPages = pages;
+
+        if (disassembly != nullptr) {
+            disassembly->invalidateAll();
+        }
+    }
+
+    bool Memory::loadProgram(const std::uint8_t* data, const std::size_t size)
+    {
+        if (size > maxBufferSize - 0x200) {
+            return false;
+        }
+
+        const std::array<std::uint8_t, maxBufferSize - 0x200> zeros{};
+
+        writeBlock(0x200, zeros.data(), zeros.size());
+        writeBlock(0x200, data, size);
+
+        originalPages = pages;
+
+        if (disassembly != nullptr) {
+            disassembly->invalidateAll();
+        }
+
+        return true;
+    }
+
+    void Memory::restore(const std::uint8_t* data)
+    {
+        for (int i = 0; i < pageCount; i++) {
+            const std::uint8_t* source = data + i * pageSize;
+
+            if (!std::equal(source, source + pageSize, pages[i]->begin())) {
+                std::copy_n(source, pageSize, getWritablePage(i).begin());
+            }
+        }
+
+        if (disassembly != nullptr) {
+            disassembly->invalidateAll();
+        }
+    }
+
+    void Memory::setDisassembly(c8::disassembly::Cache* cache)
+    {
+        disassembly = cache;
+    }
 
-        std::memcpy(originalBuffer, buffer, maxBufferSize);
+    void initialize()
+    {
+        c8::defaultMachine().getMemory().initialize();
+    }
+
+    void reset()
+    {
+        c8::defaultMachine().getMemory().reset();
+    }
+
+    void fillListing(const std::uint16_t pc, Listing& listing)
+    {
+        c8::defaultMachine().getMemory().fillListing(pc, listing, c8::defaultMachine().getBreakpoints());
+    }
+
+    std::uint8_t readByte(const std::uint16_t addr) 
+    {
+        return c8::defaultMachine().getMemory().readByte(addr);
+    }
+
+    std::uint16_t readWord(const std::uint16_t addr)
+    {
+        return c8::defaultMachine().getMemory().readWord(addr);
+    }
+
+    void writeByte(const int addr, const std::uint8_t data)
+    {
+        c8::defaultMachine().getMemory().writeByte(addr, data);
+    }
+
+    void loadProgram(std::istream& file)
+    {
+        c8::defaultMachine().getMemory().loadProgram(file);
     }
 
     std::uint16_t getFontSpriteAddress(const std::uint8_t spriteIndex)
@@ -20,18 +20,175 @@
 #include <fstream>
 #include <algorithm>
 #include <cstdint>
+#include <cstddef>
+#include <array>
+#include <memory>
 
-#include <SFML/Graphics.hpp>
-
+#include "breakpoints.hpp"
 #include "vga.hpp"
+#include "format.hpp"
+
+namespace c8::disassembly
+{
+    class Cache;
+}
 
 namespace c8::mem
 {
+    inline constexpr int maxBufferSize = 4096;
+
+    // Memory is split into pages that copies of a Memory share until one of
+    // them writes to the page
+    inline constexpr int pageSize = 256;
+    inline constexpr int pageCount = maxBufferSize / pageSize;
+
+    using Page = std::array<std::uint8_t, pageSize>;
+
+    inline constexpr int linesAroundPc = 10;
+    inline constexpr int listingLineCount = linesAroundPc * 2 + 1;
+
+    using Listing = std::array<c8::format::Line, listingLineCount>;
+
+    static_assert(c8::breakpoints::addressCount == maxBufferSize);
+
+    /**
+     * Address shown on line of a listing centered on pc
+    */
+    inline std::uint16_t getListingAddress(const std::uint16_t pc, const int line)
+    {
+        return static_cast<std::uint16_t>(pc - linesAroundPc * 2 + line * 2);
+    }
+
+    // The address space drawn as a square, one row of 64 bytes per line
+    inline constexpr int heatmapSide = 64;
+
+    static_assert(heatmapSide * heatmapSide == maxBufferSize);
+
+    /**
+     * How often one address was read, written and fetched as part of an
+     * instruction, each scaled logarithmically to 0-255 against the most
+     * accessed address
+    */
+    struct HeatmapCell
+    {
+        std::uint8_t reads;
+        std::uint8_t writes;
+        std::uint8_t fetches;
+    };
+
+    using Heatmap = std::array<HeatmapCell, maxBufferSize>;
+
+    class Memory
+    {
+    private:
+        std::array<std::shared_ptr<Page>, pageCount> pages;
+
+        // Pages as they were after the last program was loaded, reset copies
+        // them back into pages only this Memory holds and shares the rest
+        std::array<std::shared_ptr<Page>, pageCount> originalPages;
+
+        c8::disassembly::Cache* disassembly = nullptr;
+
+        /**
+         * Copies the page first if anything else still shares it
+        */
+        Page& getWritablePage(const int index);
+
+        /**
+         * Writes without invalidating the disassembly, the callers do that
+         * once for the whole block
+        */
+        void writeBlock(const int addr, const std::uint8_t* data, const std::size_t size);
+
+        void zeroMemory();
+
+        void writeSprite(const std::uint16_t addr, const std::uint8_t* sprite);
+
+        void writeSprites();
+
+        void loadDefaultProgram();
+
+        void setMemoryInfoLine(
+            c8::format::Line& line,
+            const std::uint16_t addr, 
+            const bool isCurrentAddr,
+            const bool hasBreakpoint) const;
+
+    public:
+        /**
+         * Clears memory and loads the font sprites and the default program
+        */
+        void initialize();
+
+        /**
+         * Restores memory to how it was after the last program was loaded
+        */
+        void reset();
+
+        /**
+         * Gives this Memory its own copy of every page it still shares, so
+         * that later writes never allocate. Hosts call this after loading a
+         * program to keep the emulation loop free of allocations.
+        */
+        void unsharePages();
+
+        std::uint8_t readByte(const std::uint16_t addr) const;
+
+        std::uint16_t readWord(const std::uint16_t addr) const;
+
+        void writeByte(const int addr, const std::uint8_t data);
+
+        /**
+         * Copies all maxBufferSize bytes to data
+        */
+        void copyTo(std::uint8_t* data) const;
+
+        /**
+         * Number of pages also referenced by another Memory or by the
+         * loaded program
+        */
+        int getSharedPageCount() const;
+
+        void loadProgram(std::istream& file);
+
+        /**
+         * Replaces everything from 0x200 up with size bytes of data, returns
+         * false without changing anything if they do not fit
+        */
+        bool loadProgram(const std::uint8_t* data, const std::size_t size);
+
+        /**
+         * Overwrites all maxBufferSize bytes with data, used to restore a
+         * saved machine state. Pages that already hold the same bytes stay
+         * shared.
+        */
+        void restore(const std::uint8_t* data);
+
+        /**
+         * Disassembles the instructions around pc into listing, marking the
+         * lines that have a breakpoint
+        */
+        void fillListing(
+            const std::uint16_t pc,
+            Listing& listing,
+            const c8::breakpoints::Bitmap& breakpoints) const;
+
+        /**
+         * Every write is reported to cache so it can drop stale entries,
+         * nullptr disables this
+        */
+        void setDisassembly(c8::disassembly::Cache* cache);
+    };
+
+    /*
+     * The functions below operate on the memory of c8::defaultMachine()
+    */
+
     void initialize();
 
     void reset();
 
-    void render(sf::RenderTexture& texture);
+    void fillListing(const std::uint16_t pc, Listing& listing);
 
     std::uint8_t readByte(const std::uint16_t addr);
 
@@ -41,5 +198,5 @@ namespace c8::mem
 
     std::uint16_t getFontSpriteAddress(const std::uint8_t spriteIndex);
 
-    void loadProgram(std::ifstream& file);
+    void loadProgram(std::istream& file);
 }
@@ -14,12 +14,9 @@
 */
 
 #include "opcodes.hpp"
-#include "ui.hpp"
+#include "format.hpp"
 
 #include <string>
-#include <sstream>
-#include <iomanip>
-#include <iostream>
 
 namespace c8::opcodes
 {
@@ -197,7 +194,7 @@ namespace c8::opcodes
         return Opcode::Invalid;
     }
 
-    std::string getOpcodeName(const std::uint16_t word)
+    void formatOpcodeName(const std::uint16_t word, c8::format::Line& line)
     {
         const Opcode opcode = c8::opcodes::decode(word);
 
@@ -208,115 +205,147 @@ namespace c8::opcodes
         const std::uint8_t kk = c8::opcodes::getOpcodeKK(word);
         const std::uint16_t nnn = c8::opcodes::getOpcodeNNN(word);
 
-        std::stringstream ss;
+        line.clear();
 
         switch (opcode) {
         case Opcode::CLS:
-            ss << "CLS";
+            line.append("CLS");
             break;
         case Opcode::RET:
-            ss << "RET";
+            line.append("RET");
             break;
         case Opcode::JP_Addr:
-            ss << "JP 0x" << std::setfill('0') << std::setw(3) << std::uppercase << std::hex << nnn << std::dec << " (" << nnn << ")";
+            line.append("JP 0x").appendHexDigits(nnn, 3).append(" (").appendDec(nnn).append(')');
             break;
         case Opcode::CALL_Addr:
-            ss << "CALL 0x" << std::setfill('0') << std::setw(3) << std::uppercase << std::hex << nnn << std::dec << " (" << nnn << ")";
+            line.append("CALL 0x").appendHexDigits(nnn, 3).append(" (").appendDec(nnn).append(')');
             break;
         case Opcode::SE_Vx_Byte:
-            ss << "SE V" << std::uppercase << std::hex << x << ", " << c8::ui::Hex{kk};
+            line.append("SE V").appendHexDigits(x, 1).append(", ").appendHex(kk);
             break;
         case Opcode::SNE_Vx_Byte:
-            ss << "SNE V" << std::uppercase << std::hex << x << ", " << c8::ui::Hex{kk};
+            line.append("SNE V").appendHexDigits(x, 1).append(", ").appendHex(kk);
             break;
         case Opcode::SE_Vx_Vy:
-            ss << "SE V" << std::uppercase << std::hex << x << ", V" << std::uppercase << std::hex << y;
+            line.append("SE V").appendHexDigits(x, 1).append(", V").appendHexDigits(y, 1);
             break;
         case Opcode::LD_Vx_Byte:
-            ss << "LD V" << std::uppercase << std::hex << x << ", " << c8::ui::Hex{kk};
+            line.append("LD V").appendHexDigits(x, 1).append(", ").appendHex(kk);
             break;
         case Opcode::ADD_Vx_Byte:
-            ss << "ADD V" << std::uppercase << std::hex << x << ", " << c8::ui::Hex{kk};
+            line.append("ADD V").appendHexDigits(x, 1).append(", ").appendHex(kk);
             break;
         case Opcode::LD_Vx_Vy:
-            ss << "LD V" << std::uppercase << std::hex << x << ", V" << std::uppercase << std::hex << y;
+            line.append("LD V").appendHexDigits(x, 1).append(", V").appendHexDigits(y, 1);
             break;
         case Opcode::OR_Vx_Vy:
-            ss << "OR V" << std::uppercase << std::hex << x << ", V" << std::uppercase << std::hex << y;
+            line.append("OR V").appendHexDigits(x, 1).append(", V").appendHexDigits(y, 1);
             break;
         case Opcode::AND_Vx_Vy:
-            ss << "AND V" << std::uppercase << std::hex << x << ", V" << std::uppercase << std::hex << y;
+            line.append("AND V").appendHexDigits(x, 1).append(", V").appendHexDigits(y, 1);
             break;
         case Opcode::XOR_Vx_Vy:
-            ss << "XOR V" << std::uppercase << std::hex << x << ", V" << std::uppercase << std::hex << y;
+            line.append("XOR V").appendHexDigits(x, 1).append(", V").appendHexDigits(y, 1);
             break;
         case Opcode::ADD_Vx_Vy:
-            ss << "ADD V" << std::uppercase << std::hex << x << ", V" << std::uppercase << std::hex << y;
+            line.append("ADD V").appendHexDigits(x, 1).append(", V").appendHexDigits(y, 1);
             break;
         case Opcode::SUB_Vx_Vy:
-            ss << "SUB V" << std::uppercase << std::hex << x << ", V" << std::uppercase << std::hex << y;
+            line.append("SUB V").appendHexDigits(x, 1).append(", V").appendHexDigits(y, 1);
             break;
         case Opcode::SHR_Vx_Vy:
-            ss << "SHR V" << std::uppercase << std::hex << x << ", V" << std::uppercase << std::hex << y;
+            line.append("SHR V").appendHexDigits(x, 1).append(", V").appendHexDigits(y, 1);
             break;
         case Opcode::SUBN_Vx_Vy:
-            ss << "SUBN V" << std::uppercase << std::hex << x << ", V" << std::uppercase << std::hex << y;
+            line.append("SUBN V").appendHexDigits(x, 1).append(", V").appendHexDigits(y, 1);
             break;
         case Opcode::SHL_Vx_Vy:
-            ss << "SHL V" << std::uppercase << std::hex << x << ", V" << std::uppercase << std::hex << y;
+            line.append("SHL V").appendHexDigits(x, 1).append(", V").appendHexDigits(y, 1);
             break;
         case Opcode::SNE_Vx_Vy:
-            ss << "SNE V" << std::uppercase << std::hex << x << ", V" << std::uppercase << std::hex << y;
+            line.append("SNE V").appendHexDigits(x, 1).append(", V").appendHexDigits(y, 1);
             break;
         case Opcode::LD_I_Addr:
-            ss << "LD I, 0x" << std::setfill('0') << std::setw(3) << std::uppercase << std::hex << nnn << std::dec << " (" << nnn << ")";
+            line.append("LD I, 0x").appendHexDigits(nnn, 3).append(" (").appendDec(nnn).append(')');
             break;
         case Opcode::JP_V0_Addr:
-            ss << "JP V0, 0x" << std::setfill('0') << std::setw(3) << std::uppercase << std::hex << nnn << std::dec << " (" << nnn << ")";
+            line.append("JP V0, 0x").appendHexDigits(nnn, 3).append(" (").appendDec(nnn).append(')');
             break;
         case Opcode::RND_Vx_Byte:
-            ss << "RND V" << std::uppercase << std::hex << x << ", " << c8::ui::Hex{kk};
+            line.append("RND V").appendHexDigits(x, 1).append(", ").appendHex(kk);
             break;
         case Opcode::DRW_Vx_Vy_Nibble:
-            ss << "DRW V" << std::uppercase << std::hex << x << ", V" << std::uppercase << std::hex << y << ", " << z;
+            line.append("DRW V").appendHexDigits(x, 1).append(", V").appendHexDigits(y, 1).append(", ").appendHexDigits(z, 1);
             break;
         case Opcode::SKP_Vx:
-            ss << "SKP V" << std::uppercase << std::hex << x;
+            line.append("SKP V").appendHexDigits(x, 1);
             break;
         case Opcode::SKNP_Vx:
-            ss << "SKNP V" << std::uppercase << std::hex << x;
+            line.append("SKNP V").appendHexDigits(x, 1);
             break;
         case Opcode::LD_Vx_DT:
-            ss << "LD V" << std::uppercase << std::hex << x << ", DT";
+            line.append("LD V").appendHexDigits(x, 1).append(", DT");
             break;
         case Opcode::LD_Vx_K:
-            ss << "LD V" << std::uppercase << std::hex << x << ", K";
+            line.append("LD V").appendHexDigits(x, 1).append(", K");
             break;
         case Opcode::LD_DT_Vx:
-            ss << "LD DT, V" << std::uppercase << std::hex << x;
+            line.append("LD DT, V").appendHexDigits(x, 1);
             break;
         case Opcode::LD_ST_Vx:
-            ss << "LD ST, V" << std::uppercase << std::hex << x;
+            line.append("LD ST, V").appendHexDigits(x, 1);
             break;
         case Opcode::ADD_I_Vx:
-            ss << "ADD I, V" << std::uppercase << std::hex << x;
+            line.append("ADD I, V").appendHexDigits(x, 1);
             break;
         case Opcode::LD_F_Vx:
-            ss << "LD F, V" << std::uppercase << std::hex << x;
+            line.append("LD F, V").appendHexDigits(x, 1);
             break;
         case Opcode::LD_B_Vx:
-            ss << "LD B, V" << std::uppercase << std::hex << x;
+            line.append("LD B, V").appendHexDigits(x, 1);
             break;
         case Opcode::LD_IAddr_Vx:
-            ss << "LD [I], V" << std::uppercase << std::hex << x;
+            line.append("LD [I], V").appendHexDigits(x, 1);
             break;
         case Opcode::LD_Vx_IAddr:
-            ss << "LD V" << std::uppercase << std::hex << x << ", [I]";
+            line.append("LD V").appendHexDigits(x, 1).append(", [I]");
             break;
         case Opcode::Invalid:
             break;
         }
+    }
+
+    std::string getOpcodeName(const std::uint16_t word)
+    {
+        c8::format::Line line;
+
+        formatOpcodeName(word, line);
+
+        return std::string{line.view()};
+    }
+
+    std::string_view getOpcodeIdentifier(const Opcode opcode)
+    {
+        // Indexed by the enumerator value plus one, so Invalid comes first
+        constexpr std::string_view identifiers[opcodeCount] = {
+            "Invalid",
+            "CLS", "RET", "JP_Addr", "CALL_Addr",
+            "SE_Vx_Byte", "SNE_Vx_Byte", "SE_Vx_Vy", "LD_Vx_Byte",
+            "ADD_Vx_Byte", "LD_Vx_Vy", "OR_Vx_Vy", "AND_Vx_Vy",
+            "XOR_Vx_Vy", "ADD_Vx_Vy", "SUB_Vx_Vy", "SHR_Vx_Vy",
+            "SUBN_Vx_Vy", "SHL_Vx_Vy", "SNE_Vx_Vy", "LD_I_Addr",
+            "JP_V0_Addr", "RND_Vx_Byte", "DRW_Vx_Vy_Nibble", "SKP_Vx",
+            "SKNP_Vx", "LD_Vx_DT", "LD_Vx_K", "LD_DT_Vx",
+            "LD_ST_Vx", "ADD_I_Vx", "LD_F_Vx", "LD_B_Vx",
+            "LD_IAddr_Vx", "LD_Vx_IAddr"
+        };
+
+        const int index = static_cast<int>(opcode) + 1;
+
+        if (index < 0 || index >= opcodeCount) {
+            return "Invalid";
+        }
 
-        return std::string{ss.str()};
+        return identifiers[index];
     }
 }
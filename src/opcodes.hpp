@@ -16,8 +16,11 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <cstdint>
 
+#include "format.hpp"
+
 namespace c8::opcodes
 {
     enum class Opcode: int
@@ -59,6 +62,9 @@ namespace c8::opcodes
         LD_Vx_IAddr = 33
     };
 
+    // Number of Opcode values, including Invalid
+    inline constexpr int opcodeCount = 35;
+
     /**
      * opcode instruction = xxxx 0000 0000 0000
     */
@@ -91,5 +97,15 @@ namespace c8::opcodes
 
     Opcode decode(const std::uint16_t opcode);
 
+    /**
+     * Writes the mnemonic for opcode into line without allocating
+    */
+    void formatOpcodeName(const std::uint16_t opcode, c8::format::Line& line);
+
     std::string getOpcodeName(const std::uint16_t opcode);
+
+    /**
+     * The name of the Opcode enumerator, e.g. "ADD_Vx_Byte"
+    */
+    std::string_view getOpcodeIdentifier(const Opcode opcode);
 }
\ No newline at end of file
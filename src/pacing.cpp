@@ -0,0 +1,188 @@
+/**
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "pacing.hpp"
+
+#include <thread>
+#include <algorithm>
+
+#include "config.hpp"
+
+namespace c8::pacing
+{
+    void IntervalHistogram::record(const clock::duration interval)
+    {
+        const auto bucket = static_cast<std::uint16_t>(std::clamp<std::int64_t>(
+            interval / bucketWidth, 0, bucketCount - 1));
+
+        if (sampleCount == windowSize) {
+            buckets[window[windowIndex]]--;
+        } else {
+            sampleCount++;
+        }
+
+        window[windowIndex] = bucket;
+        buckets[bucket]++;
+
+        windowIndex = (windowIndex + 1) % windowSize;
+    }
+
+    std::chrono::microseconds IntervalHistogram::percentile(const int percentile) const
+    {
+        if (sampleCount == 0) {
+            return std::chrono::microseconds{0};
+        }
+
+        const int target = std::max(1, (sampleCount * percentile + 99) / 100);
+
+        int seen = 0;
+
+        for (int i = 0; i < bucketCount; i++) {
+            seen += buckets[i];
+
+            if (seen >= target) {
+                return bucketWidth * (i + 1);
+            }
+        }
+
+        return bucketWidth * bucketCount;
+    }
+
+    CycleAccumulator::CycleAccumulator(const int frequency)
+        : frequency{frequency}
+    {
+    }
+
+    int CycleAccumulator::advance(const std::chrono::nanoseconds elapsed)
+    {
+        constexpr std::int64_t nanosecondsPerSecond = 1'000'000'000;
+
+        remainder += elapsed.count() * frequency;
+
+        const std::int64_t cycles = remainder / nanosecondsPerSecond;
+
+        remainder %= nanosecondsPerSecond;
+
+        return static_cast<int>(cycles);
+    }
+
+    CatchUpScheduler::CatchUpScheduler(const int frequency, const int framesPerSecond)
+        : wallCycles{frequency}, frequency{frequency}, framesPerSecond{framesPerSecond}
+    {
+    }
+
+    int CatchUpScheduler::cyclesForFrame(const std::chrono::nanoseconds elapsed)
+    {
+        nominalRemainder += frequency;
+
+        const std::int64_t nominal = nominalRemainder / framesPerSecond;
+
+        nominalRemainder %= framesPerSecond;
+
+        const std::int64_t previousBacklog = backlog;
+        const std::int64_t owed = wallCycles.advance(elapsed) + previousBacklog;
+
+        const std::int64_t budget = nominal + c8::config::maxCatchUpCyclesPerFrame;
+        const std::int64_t cycles = std::min(owed, budget);
+
+        // Cycles above the nominal count only catch up on the backlog they came from,
+        // a long frame with no backlog is just wall time being followed
+        caughtUpCycles += std::min(previousBacklog, std::max<std::int64_t>(0, cycles - nominal));
+        backlog = owed - cycles;
+
+        if (backlog > c8::config::maxBacklogCycles) {
+            droppedCycles += backlog - c8::config::maxBacklogCycles;
+            backlog = c8::config::maxBacklogCycles;
+        }
+
+        return static_cast<int>(cycles);
+    }
+
+    bool CatchUpScheduler::isBehind() const
+    {
+        return backlog > 0;
+    }
+
+    std::int64_t CatchUpScheduler::getBacklog() const
+    {
+        return backlog;
+    }
+
+    std::uint64_t CatchUpScheduler::getDroppedCycles() const
+    {
+        return droppedCycles;
+    }
+
+    std::uint64_t CatchUpScheduler::getCaughtUpCycles() const
+    {
+        return caughtUpCycles;
+    }
+
+    FramePacer::FramePacer(const int framesPerSecond)
+        : framesPerSecond{framesPerSecond}, origin{clock::now()}, lastWake{origin}
+    {
+    }
+
+    clock::time_point FramePacer::deadline(const std::int64_t frame) const
+    {
+        return origin + std::chrono::nanoseconds{frame * 1'000'000'000 / framesPerSecond};
+    }
+
+    void FramePacer::wait()
+    {
+        const clock::time_point previous = deadline(frameIndex);
+        clock::time_point next = deadline(frameIndex + 1);
+
+        // After a stall of more than a frame, restart the schedule from now
+        // rather than returning immediately for every missed deadline
+        const clock::time_point start = clock::now();
+
+        if (start - next > next - previous) {
+            origin += start - next;
+            next = start;
+        }
+
+        const clock::time_point sleepUntil = next - c8::config::pacingSpinMargin;
+
+        if (clock::now() < sleepUntil) {
+            std::this_thread::sleep_until(sleepUntil);
+        }
+
+        while (clock::now() < next) {
+            std::this_thread::yield();
+        }
+
+        frameIndex++;
+
+        const clock::time_point now = clock::now();
+
+        intervals.record(now - lastWake);
+        lastWake = now;
+    }
+
+    void FramePacer::mark()
+    {
+        const clock::time_point now = clock::now();
+
+        intervals.record(now - lastWake);
+        lastWake = now;
+        frameIndex++;
+    }
+
+    const IntervalHistogram& FramePacer::getIntervals() const
+    {
+        return intervals;
+    }
+}
@@ -0,0 +1,140 @@
+/**
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+namespace c8::pacing
+{
+    using clock = std::chrono::steady_clock;
+
+    /**
+     * Rolling histogram of the last `windowSize` frame intervals, bucketed
+     * at 10us up to 100ms.
+    */
+    class IntervalHistogram
+    {
+    private:
+        static constexpr int bucketCount = 10'000;
+        static constexpr int windowSize = 512;
+        static constexpr std::chrono::microseconds bucketWidth{10};
+
+        std::array<std::uint16_t, bucketCount> buckets{};
+        std::array<std::uint16_t, windowSize> window{};
+
+        int windowIndex = 0;
+        int sampleCount = 0;
+
+    public:
+        void record(const clock::duration interval);
+
+        /**
+         * percentile in [0, 100], returns the upper edge of the matching bucket
+        */
+        std::chrono::microseconds percentile(const int percentile) const;
+    };
+
+    /**
+     * Spreads `frequency` events per second over frames of arbitrary length
+     * using integer arithmetic, so no fraction of an event is ever lost.
+    */
+    class CycleAccumulator
+    {
+    private:
+        std::int64_t frequency;
+        std::int64_t remainder = 0;
+
+    public:
+        explicit CycleAccumulator(const int frequency);
+
+        int advance(const std::chrono::nanoseconds elapsed);
+    };
+
+    /**
+     * Keeps emulated time in step with wall time. A frame that arrives late
+     * still only runs a punctual frame's worth of cycles plus up to
+     * config::maxCatchUpCyclesPerFrame, the rest is carried as a backlog into
+     * the following frames. Backlog beyond config::maxBacklogCycles is dropped.
+    */
+    class CatchUpScheduler
+    {
+    private:
+        CycleAccumulator wallCycles;
+
+        std::int64_t frequency;
+        std::int64_t framesPerSecond;
+        std::int64_t nominalRemainder = 0;
+
+        std::int64_t backlog = 0;
+        std::uint64_t droppedCycles = 0;
+        std::uint64_t caughtUpCycles = 0;
+
+    public:
+        CatchUpScheduler(const int frequency, const int framesPerSecond);
+
+        /**
+         * Returns how many cycles to run for a frame that took `elapsed` of
+         * wall time
+        */
+        int cyclesForFrame(const std::chrono::nanoseconds elapsed);
+
+        bool isBehind() const;
+
+        std::int64_t getBacklog() const;
+
+        std::uint64_t getDroppedCycles() const;
+
+        std::uint64_t getCaughtUpCycles() const;
+    };
+
+    /**
+     * Waits for fixed-rate frame deadlines. Deadlines are computed from the
+     * frame count since start so they never drift. The wait sleeps until
+     * shortly before the deadline, then spins the rest of the way to hide
+     * OS timer slack.
+    */
+    class FramePacer
+    {
+    private:
+        int framesPerSecond;
+
+        clock::time_point origin;
+        clock::time_point lastWake;
+        std::int64_t frameIndex = 0;
+
+        IntervalHistogram intervals;
+
+    public:
+        explicit FramePacer(const int framesPerSecond);
+
+        /**
+         * Blocks until the next deadline
+        */
+        void wait();
+
+        /**
+         * Records a frame boundary that was waited for elsewhere (e.g. vsync)
+        */
+        void mark();
+
+        const IntervalHistogram& getIntervals() const;
+
+    private:
+        clock::time_point deadline(const std::int64_t frame) const;
+    };
+}
@@ -0,0 +1,185 @@
+/**
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "perf.hpp"
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace c8::perf
+{
+    namespace
+    {
+#if defined(__linux__)
+        perf_event_attr makeAttributes(const Counter counter, const bool leader)
+        {
+            perf_event_attr attr{};
+
+            attr.size = sizeof(attr);
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.read_format = PERF_FORMAT_GROUP;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+
+            // Members follow the leader, so only the leader starts disabled
+            attr.disabled = leader ? 1 : 0;
+
+            switch (counter) {
+            case Counter::Cycles:
+                attr.config = PERF_COUNT_HW_CPU_CYCLES;
+                break;
+            case Counter::Instructions:
+                attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+                break;
+            case Counter::BranchMisses:
+                attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+                break;
+            case Counter::L1dMisses:
+                attr.type = PERF_TYPE_HW_CACHE;
+                attr.config = PERF_COUNT_HW_CACHE_L1D
+                    | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                    | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+                break;
+            }
+
+            return attr;
+        }
+#endif
+    }
+
+    std::string_view getCounterName(const Counter counter)
+    {
+        constexpr std::string_view names[counterCount] = {
+            "cycles",
+            "instructions",
+            "branch misses",
+            "L1D misses"
+        };
+
+        return names[static_cast<int>(counter)];
+    }
+
+    std::uint64_t Sample::get(const Counter counter) const
+    {
+        return values[static_cast<int>(counter)];
+    }
+
+    bool Sample::has(const Counter counter) const
+    {
+        return available[static_cast<int>(counter)];
+    }
+
+    CounterGroup::CounterGroup() :
+        CounterGroup({true, true, true, true})
+    {
+    }
+
+    CounterGroup::CounterGroup(const std::array<bool, counterCount>& mask)
+    {
+        fds.fill(-1);
+        readIndices.fill(-1);
+
+#if defined(__linux__)
+        for (int i = 0; i < counterCount; i++) {
+            if (!mask[i]) {
+                continue;
+            }
+
+            const bool leader = leaderFd < 0;
+
+            perf_event_attr attr = makeAttributes(static_cast<Counter>(i), leader);
+
+            const int fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, leaderFd, 0));
+
+            if (fd < 0) {
+                continue;
+            }
+
+            if (leader) {
+                leaderFd = fd;
+            }
+
+            fds[i] = fd;
+            readIndices[i] = openedCount++;
+        }
+#endif
+    }
+
+    CounterGroup::~CounterGroup()
+    {
+#if defined(__linux__)
+        for (const int fd : fds) {
+            if (fd >= 0) {
+                close(fd);
+            }
+        }
+#endif
+    }
+
+    bool CounterGroup::isAvailable() const
+    {
+        return leaderFd >= 0;
+    }
+
+    bool CounterGroup::has(const Counter counter) const
+    {
+        return fds[static_cast<int>(counter)] >= 0;
+    }
+
+    void CounterGroup::start()
+    {
+#if defined(__linux__)
+        if (leaderFd >= 0) {
+            ioctl(leaderFd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+            ioctl(leaderFd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        }
+#endif
+    }
+
+    Sample CounterGroup::stop()
+    {
+        Sample sample;
+
+#if defined(__linux__)
+        if (leaderFd < 0) {
+            return sample;
+        }
+
+        ioctl(leaderFd, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+
+        // A group read is the number of counters followed by their values
+        std::array<std::uint64_t, counterCount + 1> buffer{};
+
+        const auto size = static_cast<ssize_t>((openedCount + 1) * sizeof(std::uint64_t));
+
+        if (read(leaderFd, buffer.data(), size) != size) {
+            return sample;
+        }
+
+        for (int i = 0; i < counterCount; i++) {
+            if (readIndices[i] >= 0) {
+                sample.values[i] = buffer[readIndices[i] + 1];
+                sample.available[i] = true;
+            }
+        }
+#endif
+
+        return sample;
+    }
+}
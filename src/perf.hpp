@@ -0,0 +1,97 @@
+/**
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+namespace c8::perf
+{
+    /**
+     * Hardware events counted for this thread, in user space only
+    */
+    enum class Counter : int
+    {
+        Cycles,
+        Instructions,
+        BranchMisses,
+        L1dMisses
+    };
+
+    inline constexpr int counterCount = 4;
+
+    std::string_view getCounterName(const Counter counter);
+
+    /**
+     * Counts read from a CounterGroup. A counter that could not be opened is
+     * not available and reads as 0.
+    */
+    struct Sample
+    {
+        std::array<std::uint64_t, counterCount> values{};
+        std::array<bool, counterCount> available{};
+
+        std::uint64_t get(const Counter counter) const;
+
+        bool has(const Counter counter) const;
+    };
+
+    /**
+     * Opens the counters as one perf_event_open group, so they are started,
+     * stopped and scheduled together. Counters the CPU or kernel does not
+     * offer are left out, and outside Linux, or where perf events are
+     * restricted or virtualized away, nothing is available.
+     *
+     * The counters count the thread that constructs the group.
+    */
+    class CounterGroup
+    {
+    private:
+        std::array<int, counterCount> fds;
+
+        // Position of each opened counter in a group read, -1 if not opened
+        std::array<int, counterCount> readIndices;
+
+        int leaderFd = -1;
+        int openedCount = 0;
+
+    public:
+        CounterGroup();
+
+        // Only the counters in mask are opened
+        explicit CounterGroup(const std::array<bool, counterCount>& mask);
+
+        ~CounterGroup();
+
+        CounterGroup(const CounterGroup&) = delete;
+        CounterGroup& operator=(const CounterGroup&) = delete;
+
+        bool isAvailable() const;
+
+        bool has(const Counter counter) const;
+
+        /**
+         * Resets and starts every counter
+        */
+        void start();
+
+        /**
+         * Stops every counter and reads what they counted since start()
+        */
+        Sample stop();
+    };
+}
@@ -0,0 +1,165 @@
+/**
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "phases.hpp"
+
+#include <algorithm>
+#include <iomanip>
+
+namespace c8::phases
+{
+    std::string_view getPhaseName(const Phase phase)
+    {
+        constexpr std::string_view names[phaseCount] = {
+            "commands",
+            "execute",
+            "snapshot",
+            "emulation sleep",
+            "poll input",
+            "draw setup",
+            "draw vga",
+            "draw overlay",
+            "draw cpu info",
+            "draw memory",
+            "present",
+            "render sleep"
+        };
+
+        return names[static_cast<int>(phase)];
+    }
+
+    Recorder::Scope::Scope(Recorder& recorder, const Phase phase) :
+        recorder(recorder),
+        phase(phase),
+        start(clock::now())
+    {
+    }
+
+    Recorder::Scope::~Scope()
+    {
+        recorder.record(phase, start, clock::now());
+    }
+
+    Recorder::Recorder(const int threadId) :
+        threadId(threadId)
+    {
+    }
+
+    void Recorder::startCapture(const std::size_t maxEvents)
+    {
+        events.assign(maxEvents, {});
+        nextEvent = 0;
+        eventsWrapped = false;
+    }
+
+    void Recorder::record(const Phase phase, const clock::time_point start, const clock::time_point end)
+    {
+        const int index = static_cast<int>(phase);
+
+        durations[index][nextSamples[index]] = std::chrono::nanoseconds{end - start}.count();
+        nextSamples[index] = (nextSamples[index] + 1) % windowSize;
+        sampleCounts[index] = std::min(sampleCounts[index] + 1, windowSize);
+
+        if (events.empty()) {
+            return;
+        }
+
+        events[nextEvent] = {phase, start, end - start};
+
+        nextEvent++;
+
+        if (nextEvent == events.size()) {
+            nextEvent = 0;
+            eventsWrapped = true;
+        }
+    }
+
+    Recorder::Scope Recorder::time(const Phase phase)
+    {
+        return Scope{*this, phase};
+    }
+
+    void Recorder::fillSummary(Summary& summary) const
+    {
+        std::array<std::int64_t, windowSize> sorted;
+
+        for (int i = 0; i < phaseCount; i++) {
+            const int count = sampleCounts[i];
+
+            if (count == 0) {
+                continue;
+            }
+
+            std::copy_n(durations[i].begin(), count, sorted.begin());
+            std::sort(sorted.begin(), sorted.begin() + count);
+
+            summary[i].p50 = std::chrono::nanoseconds{sorted[(count - 1) * 50 / 100]};
+            summary[i].p99 = std::chrono::nanoseconds{sorted[(count - 1) * 99 / 100]};
+        }
+    }
+
+    int Recorder::getThreadId() const
+    {
+        return threadId;
+    }
+
+    std::vector<Event> Recorder::getEvents() const
+    {
+        if (!eventsWrapped) {
+            return {events.begin(), events.begin() + nextEvent};
+        }
+
+        std::vector<Event> ordered{events.begin() + nextEvent, events.end()};
+
+        ordered.insert(ordered.end(), events.begin(), events.begin() + nextEvent);
+
+        return ordered;
+    }
+
+    void writeChromeTrace(
+        std::ostream& out,
+        const std::vector<const Recorder*>& recorders,
+        const clock::time_point origin)
+    {
+        using microseconds = std::chrono::duration<double, std::micro>;
+
+        // Timestamps run into the millions of microseconds, which the default
+        // precision would print in scientific notation
+        const auto flags = out.flags();
+        const auto precision = out.precision();
+
+        bool first = true;
+
+        out << std::fixed << std::setprecision(3);
+        out << "{\"traceEvents\": [";
+
+        for (const Recorder* recorder : recorders) {
+            for (const Event& event : recorder->getEvents()) {
+                out << (first ? "\n" : ",\n");
+                out << "  {\"name\": \"" << getPhaseName(event.phase) << "\", \"ph\": \"X\""
+                    << ", \"ts\": " << microseconds{event.start - origin}.count()
+                    << ", \"dur\": " << microseconds{event.duration}.count()
+                    << ", \"pid\": 1, \"tid\": " << recorder->getThreadId() << "}";
+
+                first = false;
+            }
+        }
+
+        out << "\n], \"displayTimeUnit\": \"ms\"}\n";
+
+        out.flags(flags);
+        out.precision(precision);
+    }
+}
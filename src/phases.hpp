@@ -0,0 +1,151 @@
+/**
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string_view>
+#include <vector>
+
+namespace c8::phases
+{
+    using clock = std::chrono::steady_clock;
+
+    /**
+     * The parts of a host frame that are timed. The first four run on the
+     * emulation thread, the rest on the render thread.
+    */
+    enum class Phase : int
+    {
+        Commands,
+        Execute,
+        Snapshot,
+        EmulationSleep,
+        PollInput,
+        DrawSetup,
+        DrawVga,
+        DrawOverlay,
+        DrawCpuInfo,
+        DrawMemory,
+        Present,
+        RenderSleep
+    };
+
+    inline constexpr int phaseCount = 12;
+
+    // Durations kept per phase for the rolling percentiles
+    inline constexpr int windowSize = 256;
+
+    std::string_view getPhaseName(const Phase phase);
+
+    /**
+     * p50 and p99 of each phase over its last windowSize frames
+    */
+    struct Percentiles
+    {
+        std::chrono::nanoseconds p50{};
+        std::chrono::nanoseconds p99{};
+    };
+
+    using Summary = std::array<Percentiles, phaseCount>;
+
+    /**
+     * One timed phase, as a Chrome trace "complete" event
+    */
+    struct Event
+    {
+        Phase phase;
+
+        clock::time_point start;
+        clock::duration duration;
+    };
+
+    /**
+     * Times the phases of one thread. Keeps the last windowSize durations of
+     * each phase, and when capturing, the last events in a ring so the
+     * frames just before exit can be written as a Chrome trace.
+    */
+    class Recorder
+    {
+    private:
+        int threadId;
+
+        std::array<std::array<std::int64_t, windowSize>, phaseCount> durations{};
+        std::array<int, phaseCount> sampleCounts{};
+        std::array<int, phaseCount> nextSamples{};
+
+        std::vector<Event> events;
+        std::size_t nextEvent = 0;
+        bool eventsWrapped = false;
+
+    public:
+        /**
+         * Ends the phase when it goes out of scope
+        */
+        class Scope
+        {
+        private:
+            Recorder& recorder;
+            Phase phase;
+            clock::time_point start;
+
+        public:
+            Scope(Recorder& recorder, const Phase phase);
+
+            ~Scope();
+
+            Scope(const Scope&) = delete;
+            Scope& operator=(const Scope&) = delete;
+        };
+
+        explicit Recorder(const int threadId);
+
+        /**
+         * Starts keeping the last maxEvents events for writeChromeTrace
+        */
+        void startCapture(const std::size_t maxEvents);
+
+        void record(const Phase phase, const clock::time_point start, const clock::time_point end);
+
+        /**
+         * Usage: const auto scope = recorder.time(Phase::Execute);
+        */
+        Scope time(const Phase phase);
+
+        /**
+         * Fills the phases this recorder has timed, leaves the others alone
+        */
+        void fillSummary(Summary& summary) const;
+
+        int getThreadId() const;
+
+        /**
+         * The captured events, oldest first
+        */
+        std::vector<Event> getEvents() const;
+    };
+
+    /**
+     * Writes the captured events of every recorder as Chrome trace event
+     * JSON, for chrome://tracing or Perfetto. Times are relative to origin.
+    */
+    void writeChromeTrace(
+        std::ostream& out,
+        const std::vector<const Recorder*>& recorders,
+        const clock::time_point origin);
+}
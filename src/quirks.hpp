@@ -19,4 +19,5 @@ namespace c8::quirks
 {
     inline constexpr bool shiftWithVy = false;
     inline constexpr bool memoryIncrementI = false;
+    inline constexpr bool wrapSprites = false;
 }
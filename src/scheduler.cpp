@@ -0,0 +1,234 @@
+/**
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "scheduler.hpp"
+
+#include <algorithm>
+
+namespace c8::scheduler
+{
+    double Stats::getCyclesPerSecond() const
+    {
+        const double seconds = wallTime.count();
+
+        return seconds > 0 ? cycles / seconds : 0;
+    }
+
+    Scheduler::Scheduler(unsigned int threadCount)
+    {
+        if (threadCount == 0) {
+            threadCount = std::max(1u, std::thread::hardware_concurrency());
+        }
+
+        for (unsigned int i = 0; i < threadCount; i++) {
+            workers.push_back(std::make_unique<Worker>());
+        }
+
+        for (unsigned int i = 1; i < threadCount; i++) {
+            threads.emplace_back(&Scheduler::workerLoop, this, i);
+        }
+    }
+
+    Scheduler::~Scheduler()
+    {
+        stopping.store(true);
+
+        round.fetch_add(1);
+        round.notify_all();
+
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+    }
+
+    bool Scheduler::popTask(const std::size_t workerIndex, Task& task)
+    {
+        Worker& worker = *workers[workerIndex];
+
+        std::lock_guard lock{worker.mutex};
+
+        if (worker.tasks.empty()) {
+            return false;
+        }
+
+        task = worker.tasks.back();
+        worker.tasks.pop_back();
+
+        return true;
+    }
+
+    bool Scheduler::stealTask(const std::size_t workerIndex, Task& task)
+    {
+        for (std::size_t i = 1; i < workers.size(); i++) {
+            Worker& victim = *workers[(workerIndex + i) % workers.size()];
+
+            std::lock_guard lock{victim.mutex};
+
+            if (victim.tasks.empty()) {
+                continue;
+            }
+
+            task = victim.tasks.front();
+            victim.tasks.pop_front();
+
+            workers[workerIndex]->steals++;
+
+            return true;
+        }
+
+        return false;
+    }
+
+    void Scheduler::runTasks(const std::size_t workerIndex)
+    {
+        using clock = std::chrono::steady_clock;
+
+        Worker& worker = *workers[workerIndex];
+
+        const bool timed = !machineTimes.empty();
+
+        Task task;
+
+        while (popTask(workerIndex, task) || stealTask(workerIndex, task)) {
+            for (std::size_t i = task.begin; i < task.end; i++) {
+                c8::Machine& machine = *machines[i];
+
+                const auto start = timed ? clock::now() : clock::time_point{};
+
+                for (std::uint64_t remaining = sliceCycles; remaining > 0;) {
+                    const int chunk = static_cast<int>(std::min<std::uint64_t>(remaining, 1 << 30));
+
+                    remaining -= chunk;
+
+                    // Stopped at a breakpoint, the rest of the slice would
+                    // only find the machine paused
+                    if (machine.executeClockCycles(chunk) < chunk) {
+                        break;
+                    }
+                }
+
+                if (timed) {
+                    machineTimes[i] += clock::now() - start;
+                }
+            }
+
+            worker.slices += task.end - task.begin;
+            worker.cycles += (task.end - task.begin) * sliceCycles;
+
+            if (pendingTasks.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                pendingTasks.notify_all();
+            }
+        }
+    }
+
+    void Scheduler::workerLoop(const std::size_t workerIndex)
+    {
+        std::uint64_t seenRound = 0;
+
+        while (true) {
+            round.wait(seenRound);
+            seenRound = round.load();
+
+            if (stopping.load()) {
+                return;
+            }
+
+            runTasks(workerIndex);
+        }
+    }
+
+    void Scheduler::step(
+        std::span<c8::Machine* const> stepMachines,
+        const std::uint64_t stepSliceCycles,
+        std::span<std::chrono::duration<double>> stepMachineTimes)
+    {
+        using clock = std::chrono::steady_clock;
+
+        if (stepMachines.empty() || stepSliceCycles == 0) {
+            return;
+        }
+
+        const auto start = clock::now();
+
+        machines = stepMachines;
+        machineTimes = stepMachineTimes;
+        sliceCycles = stepSliceCycles;
+
+        // Worker n always gets the n-th contiguous share of the machines
+        const std::size_t share = (machines.size() + workers.size() - 1) / workers.size();
+
+        auto getShareBegin = [&](const std::size_t w) {
+            return std::min(w * share, machines.size());
+        };
+
+        std::size_t taskCount = 0;
+
+        for (std::size_t w = 0; w < workers.size(); w++) {
+            const std::size_t shareSize = getShareBegin(w + 1) - getShareBegin(w);
+
+            taskCount += (shareSize + machinesPerTask - 1) / machinesPerTask;
+        }
+
+        // Set before any task is queued, a worker still finishing the last
+        // step may pick up a task as soon as it is pushed
+        pendingTasks.store(taskCount);
+
+        for (std::size_t w = 0; w < workers.size(); w++) {
+            Worker& worker = *workers[w];
+
+            const std::size_t shareBegin = getShareBegin(w);
+            const std::size_t shareEnd = getShareBegin(w + 1);
+
+            std::lock_guard lock{worker.mutex};
+
+            for (std::size_t begin = shareBegin; begin < shareEnd; begin += machinesPerTask) {
+                worker.tasks.push_back({begin, std::min(begin + machinesPerTask, shareEnd)});
+            }
+        }
+
+        round.fetch_add(1);
+        round.notify_all();
+
+        runTasks(0);
+
+        std::size_t pending;
+
+        while ((pending = pendingTasks.load(std::memory_order_acquire)) != 0) {
+            pendingTasks.wait(pending);
+        }
+
+        wallTime += clock::now() - start;
+    }
+
+    std::size_t Scheduler::getThreadCount() const
+    {
+        return workers.size();
+    }
+
+    Stats Scheduler::getStats() const
+    {
+        Stats stats;
+
+        for (const auto& worker : workers) {
+            stats.slices += worker->slices;
+            stats.cycles += worker->cycles;
+            stats.steals += worker->steals;
+        }
+
+        stats.wallTime = wallTime;
+
+        return stats;
+    }
+}
@@ -0,0 +1,126 @@
+/**
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <vector>
+
+#include "machine.hpp"
+
+namespace c8::scheduler
+{
+    // Machines handed out per task, large enough that taking a task costs
+    // little next to running it
+    inline constexpr std::size_t machinesPerTask = 16;
+
+    struct Stats
+    {
+        std::uint64_t slices = 0;
+        std::uint64_t cycles = 0;
+        std::uint64_t steals = 0;
+
+        std::chrono::duration<double> wallTime{};
+
+        double getCyclesPerSecond() const;
+    };
+
+    /**
+     * Steps many machines a slice of cycles at a time on a fixed set of
+     * threads. Every worker owns a deque of tasks, pops its own from the
+     * back and steals from the front of the others' once it runs out.
+     * Machines are dealt out the same way every step, so unless work is
+     * stolen a machine keeps running on the same core and stays in its cache.
+     * The calling thread works as worker 0.
+    */
+    class Scheduler
+    {
+    private:
+        struct Task
+        {
+            std::size_t begin;
+            std::size_t end;
+        };
+
+        struct alignas(64) Worker
+        {
+            std::mutex mutex;
+            std::deque<Task> tasks;
+
+            // Only written by the thread running as this worker
+            std::uint64_t slices = 0;
+            std::uint64_t cycles = 0;
+            std::uint64_t steals = 0;
+        };
+
+        std::vector<std::unique_ptr<Worker>> workers;
+        std::vector<std::thread> threads;
+
+        std::span<c8::Machine* const> machines;
+        std::span<std::chrono::duration<double>> machineTimes;
+        std::uint64_t sliceCycles = 0;
+
+        std::atomic<std::uint64_t> round{0};
+        std::atomic<std::size_t> pendingTasks{0};
+        std::atomic<bool> stopping{false};
+
+        std::chrono::duration<double> wallTime{};
+
+        bool popTask(const std::size_t workerIndex, Task& task);
+
+        bool stealTask(const std::size_t workerIndex, Task& task);
+
+        void runTasks(const std::size_t workerIndex);
+
+        void workerLoop(const std::size_t workerIndex);
+
+    public:
+        /**
+         * threadCount includes the calling thread, 0 uses one per core
+        */
+        explicit Scheduler(unsigned int threadCount = 0);
+
+        ~Scheduler();
+
+        Scheduler(const Scheduler&) = delete;
+        Scheduler& operator=(const Scheduler&) = delete;
+
+        /**
+         * Executes sliceCycles clock cycles on every machine and returns once
+         * all of them are done. No machine may be used elsewhere meanwhile.
+         * When machineTimes is given, it holds one entry per machine, and the
+         * time each machine's slice took is added to its entry.
+        */
+        void step(
+            std::span<c8::Machine* const> machines,
+            const std::uint64_t sliceCycles,
+            std::span<std::chrono::duration<double>> machineTimes = {});
+
+        std::size_t getThreadCount() const;
+
+        /**
+         * Totals over every step so far
+        */
+        Stats getStats() const;
+    };
+}
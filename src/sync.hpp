@@ -0,0 +1,150 @@
+/**
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace c8::sync
+{
+    /**
+     * Lock-free single producer / single consumer handoff of the most recent
+     * value. The producer always has a buffer to write into and the consumer
+     * always has a complete buffer to read, neither ever waits on the other.
+    */
+    template <typename T>
+    class TripleBuffer
+    {
+    private:
+        static constexpr std::uint8_t indexMask = 0b011;
+        static constexpr std::uint8_t freshBit = 0b100;
+
+        std::array<T, 3> buffers{};
+
+        // index of the buffer in the middle, plus freshBit when it holds a
+        // value published after the consumer last looked
+        alignas(64) std::atomic<std::uint8_t> middle{1};
+
+        alignas(64) std::uint8_t writeIndex = 0;
+        alignas(64) std::uint8_t readIndex = 2;
+
+    public:
+        T& writeBuffer()
+        {
+            return buffers[writeIndex];
+        }
+
+        void publish()
+        {
+            const std::uint8_t previous = middle.exchange(writeIndex | freshBit, std::memory_order_acq_rel);
+
+            writeIndex = previous & indexMask;
+        }
+
+        /**
+         * Returns true if a newer value was published since the last call
+        */
+        bool update()
+        {
+            if ((middle.load(std::memory_order_relaxed) & freshBit) == 0) {
+                return false;
+            }
+
+            const std::uint8_t previous = middle.exchange(readIndex, std::memory_order_acq_rel);
+
+            readIndex = previous & indexMask;
+
+            return true;
+        }
+
+        const T& readBuffer() const
+        {
+            return buffers[readIndex];
+        }
+    };
+
+    /**
+     * Bounded lock-free single producer / single consumer queue
+    */
+    template <typename T, std::size_t Capacity>
+    class SpscQueue
+    {
+    private:
+        static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+        std::array<T, Capacity> items{};
+
+        alignas(64) std::atomic<std::size_t> head{0};
+        alignas(64) std::atomic<std::size_t> tail{0};
+
+        // The producer's last view of head, so a push only reads the
+        // consumer's cache line when the queue looks full
+        std::size_t cachedHead = 0;
+
+    public:
+        bool push(const T& item)
+        {
+            const std::size_t currentTail = tail.load(std::memory_order_relaxed);
+
+            if (currentTail - cachedHead == Capacity) {
+                cachedHead = head.load(std::memory_order_acquire);
+
+                if (currentTail - cachedHead == Capacity) {
+                    return false;
+                }
+            }
+
+            items[currentTail & (Capacity - 1)] = item;
+            tail.store(currentTail + 1, std::memory_order_release);
+
+            return true;
+        }
+
+        bool pop(T& item)
+        {
+            const std::size_t currentHead = head.load(std::memory_order_relaxed);
+
+            if (currentHead == tail.load(std::memory_order_acquire)) {
+                return false;
+            }
+
+            item = items[currentHead & (Capacity - 1)];
+            head.store(currentHead + 1, std::memory_order_release);
+
+            return true;
+        }
+
+        /**
+         * Pops up to maxCount items into out, returns how many
+        */
+        std::size_t popMany(T* out, const std::size_t maxCount)
+        {
+            const std::size_t currentHead = head.load(std::memory_order_relaxed);
+            const std::size_t available = tail.load(std::memory_order_acquire) - currentHead;
+            const std::size_t count = available < maxCount ? available : maxCount;
+
+            for (std::size_t i = 0; i < count; i++) {
+                out[i] = items[(currentHead + i) & (Capacity - 1)];
+            }
+
+            head.store(currentHead + count, std::memory_order_release);
+
+            return count;
+        }
+    };
+}
@@ -0,0 +1,665 @@
+/**
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "throughput.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string_view>
+
+#include "allocations.hpp"
+#include "arena.hpp"
+#include "headless.hpp"
+#include "lockstep.hpp"
+#include "machine.hpp"
+#include "perf.hpp"
+
+namespace c8::throughput
+{
+    /**
+     * Writes instructions one after the other from 0x200
+    */
+    class Assembler
+    {
+    private:
+        std::vector<std::uint8_t> bytes;
+
+    public:
+        std::uint16_t here() const
+        {
+            return static_cast<std::uint16_t>(0x200 + bytes.size());
+        }
+
+        Assembler& emit(const std::uint16_t word)
+        {
+            bytes.push_back(static_cast<std::uint8_t>(word >> 8));
+            bytes.push_back(static_cast<std::uint8_t>(word & 0xFF));
+
+            return *this;
+        }
+
+        std::vector<std::uint8_t> take()
+        {
+            return std::move(bytes);
+        }
+    };
+
+    std::vector<std::uint8_t> makeAluRom()
+    {
+        Assembler rom;
+
+        const std::uint16_t loop = rom.here();
+
+        rom.emit(0x7001)  // ADD V0, 0x01
+            .emit(0x8104) // ADD V1, V0
+            .emit(0x8215) // SUB V2, V1
+            .emit(0x8321) // OR V3, V2
+            .emit(0x8432) // AND V4, V3
+            .emit(0x8543) // XOR V5, V4
+            .emit(0x8656) // SHR V6
+            .emit(0x8767) // SUBN V7, V6
+            .emit(0x887E) // SHL V8
+            .emit(0x9010) // SNE V0, V1
+            .emit(0x7901) // ADD V9, 0x01
+            .emit(0x30FF) // SE V0, 0xFF
+            .emit(0x8A04) // ADD VA, V0
+            .emit(0x1000 | loop);
+
+        return rom.take();
+    }
+
+    std::vector<std::uint8_t> makeDrawRom()
+    {
+        Assembler rom;
+
+        rom.emit(0x6A0F); // LD VA, 0x0F
+
+        const std::uint16_t loop = rom.here();
+
+        rom.emit(0xF029)  // LD F, V0
+            .emit(0xD125) // DRW V1, V2, 5
+            .emit(0x7103) // ADD V1, 0x03
+            .emit(0x7205) // ADD V2, 0x05
+            .emit(0x7001) // ADD V0, 0x01
+            .emit(0x80A2) // AND V0, VA
+            .emit(0x1000 | loop);
+
+        return rom.take();
+    }
+
+    std::vector<std::uint8_t> makeCallRom()
+    {
+        Assembler rom;
+
+        // Recurses 14 calls deep, returns all the way out, and starts over
+        const std::uint16_t main = rom.here();
+        const std::uint16_t function = main + 6;
+
+        rom.emit(0x6000)                 // LD V0, 0x00
+            .emit(0x2000 | function)     // CALL function
+            .emit(0x1000 | main);
+
+        rom.emit(0x7001)                 // ADD V0, 0x01
+            .emit(0x300F)                // SE V0, 0x0F
+            .emit(0x2000 | function)     // CALL function
+            .emit(0x00EE);               // RET
+
+        return rom.take();
+    }
+
+    std::vector<std::uint8_t> makeMemoryCopyRom()
+    {
+        Assembler rom;
+
+        const std::uint16_t loop = rom.here();
+
+        // Copies 16 bytes from 0x300 to 0x400 and back, changing one on the
+        // way so the data is not the same every time
+        rom.emit(0xA300)  // LD I, 0x300
+            .emit(0xFF65) // LD VF, [I]
+            .emit(0x7001) // ADD V0, 0x01
+            .emit(0xA400) // LD I, 0x400
+            .emit(0xFF55) // LD [I], VF
+            .emit(0xA400) // LD I, 0x400
+            .emit(0xFF65) // LD VF, [I]
+            .emit(0xA300) // LD I, 0x300
+            .emit(0xFF55) // LD [I], VF
+            .emit(0x1000 | loop);
+
+        return rom.take();
+    }
+
+    std::vector<std::uint8_t> makeSelfModifyingRom()
+    {
+        Assembler rom;
+
+        const std::uint16_t loop = rom.here();
+        const std::uint16_t patched = loop + 8;
+
+        // Increments the byte operand of its own ADD V1 instruction
+        rom.emit(0xA000 | (patched + 1)) // LD I, patched + 1
+            .emit(0xF065)                // LD V0, [I]
+            .emit(0x7001)                // ADD V0, 0x01
+            .emit(0xF055)                // LD [I], V0
+            .emit(0x7100)                // ADD V1, <patched>
+            .emit(0x1000 | loop);
+
+        return rom.take();
+    }
+
+    std::vector<Workload> makeWorkloads()
+    {
+        std::vector<Workload> workloads;
+
+        workloads.push_back({"alu", "8xyN arithmetic, skips and a jump", makeAluRom()});
+        workloads.push_back({"draw", "DRW of font sprites across the screen", makeDrawRom()});
+        workloads.push_back({"call", "CALL/RET recursion 14 deep", makeCallRom()});
+        workloads.push_back({"memcopy", "Fx55/Fx65 copies of 16 bytes", makeMemoryCopyRom()});
+        workloads.push_back({"selfmod", "rewrites its own instruction every loop", makeSelfModifyingRom()});
+
+        return workloads;
+    }
+
+    /**
+     * FNV-1a over the registers, I, PC, SP and stack, all of memory and
+     * the frame hash, so workloads that never draw still show when the
+     * interpreter computed something different
+    */
+    std::uint64_t hashState(const c8::Machine& machine)
+    {
+        std::uint64_t hash = 0xCBF29CE484222325;
+
+        const auto add = [&hash](const std::uint64_t value, const int bytes) {
+            for (int i = 0; i < bytes; i++) {
+                hash ^= (value >> (8 * i)) & 0xFF;
+                hash *= 0x100000001B3;
+            }
+        };
+
+        const c8::cpu::CpuState& cpuState = machine.getCpuState();
+
+        for (const std::uint8_t v : cpuState.v) {
+            add(v, 1);
+        }
+
+        add(cpuState.ir, 2);
+        add(cpuState.pc, 2);
+        add(cpuState.sp, 1);
+
+        for (int i = 0; i < cpuState.sp && i < c8::cpu::maxStackDepth; i++) {
+            add(cpuState.stack[i], 2);
+        }
+
+        for (int addr = 0; addr < c8::mem::maxBufferSize; addr++) {
+            add(machine.getMemory().readByte(static_cast<std::uint16_t>(addr)), 1);
+        }
+
+        add(machine.getVgaState().hash(), 8);
+
+        return hash;
+    }
+
+    struct Options
+    {
+        std::uint64_t instructions = 20'000'000;
+        int repetitions = 5;
+
+        // Copies of each ROM for the lockstep comparison, 0 skips it
+        std::size_t lanes = 64;
+
+        std::string filter;
+        std::string jsonPath;
+    };
+
+    struct Measurement
+    {
+        std::string name;
+
+        std::uint64_t instructions = 0;
+
+        double medianMips = 0;
+        double bestMips = 0;
+
+        // 0 when the hardware counter is not available
+        double hostInstructionsPerInstruction = 0;
+
+        std::uint64_t allocations = 0;
+        std::uint64_t frameHash = 0;
+        std::uint64_t stateHash = 0;
+    };
+
+    /**
+     * One ROM run in lanes copies, by a lockstep::Batch, by as many
+     * Machines stepped one after the other, and by as many Machines with
+     * their state in an arena::Arena
+    */
+    struct LockstepMeasurement
+    {
+        std::string name;
+
+        std::size_t lanes = 0;
+
+        double batchMips = 0;
+        double machinesMips = 0;
+        double arenaMips = 0;
+
+        // Share of the batch's lane instructions run by the vector path
+        double vectorShare = 0;
+
+        // Whether every lane of the batch, and every Machine in the arena
+        // along with its rows in getRows(), ended in the same state as the
+        // Machine with its own state
+        bool matches = true;
+    };
+
+    bool parseArgs(int argc, char** argv, Options& options)
+    {
+        std::vector<std::string> args;
+
+        args.assign(argv + 1, argv + argc);
+
+        for (std::size_t i = 0; i < args.size(); i++) {
+            const std::string& arg = args[i];
+
+            if (arg == "--instructions" && i + 1 < args.size()) {
+                options.instructions = std::stoull(args[++i]);
+                continue;
+            }
+
+            if (arg == "--repetitions" && i + 1 < args.size()) {
+                options.repetitions = std::stoi(args[++i]);
+                continue;
+            }
+
+            if (arg == "--lanes" && i + 1 < args.size()) {
+                options.lanes = std::stoul(args[++i]);
+                continue;
+            }
+
+            if (arg == "--filter" && i + 1 < args.size()) {
+                options.filter = args[++i];
+                continue;
+            }
+
+            if (arg == "--json" && i + 1 < args.size()) {
+                options.jsonPath = args[++i];
+                continue;
+            }
+
+            return false;
+        }
+
+        return options.instructions > 0 && options.repetitions > 0;
+    }
+
+    Measurement measure(const Workload& workload, const Options& options, c8::perf::CounterGroup& counter)
+    {
+        Measurement measurement;
+
+        measurement.name = workload.name;
+
+        std::vector<double> mips;
+        std::vector<double> hostInstructions;
+
+        for (int i = 0; i < options.repetitions; i++) {
+            c8::Machine machine{0, 1};
+
+            machine.loadProgram(workload.rom.data(), workload.rom.size());
+            machine.getMemory().unsharePages();
+
+            const c8::allocations::Counts allocationsBefore = c8::allocations::getThreadCounts();
+
+            counter.start();
+
+            const c8::headless::Result result = c8::headless::runMachine(machine, {options.instructions, 0}, {});
+
+            const std::uint64_t hostCount = counter.stop().get(c8::perf::Counter::Instructions);
+
+            measurement.allocations = std::max(
+                measurement.allocations,
+                (c8::allocations::getThreadCounts() - allocationsBefore).allocations);
+
+            measurement.instructions = machine.getTotalCpuCycles();
+            measurement.frameHash = machine.getVgaState().hash();
+            measurement.stateHash = hashState(machine);
+
+            mips.push_back(measurement.instructions / result.wallTime.count() / 1e6);
+
+            if (counter.isAvailable() && measurement.instructions > 0) {
+                hostInstructions.push_back(static_cast<double>(hostCount) / measurement.instructions);
+            }
+        }
+
+        std::sort(mips.begin(), mips.end());
+        std::sort(hostInstructions.begin(), hostInstructions.end());
+
+        measurement.medianMips = mips[mips.size() / 2];
+        measurement.bestMips = mips.back();
+
+        if (!hostInstructions.empty()) {
+            measurement.hostInstructionsPerInstruction = hostInstructions[hostInstructions.size() / 2];
+        }
+
+        return measurement;
+    }
+
+    /**
+     * Cache-line-sized storage, so a vector of them is memory an Arena
+     * accepts
+    */
+    struct alignas(c8::arena::cacheLineSize) CacheLine
+    {
+        std::byte bytes[c8::arena::cacheLineSize];
+    };
+
+    /**
+     * Runs every machine for cycles cycles, one after the other
+    */
+    void runMachines(std::deque<c8::Machine>& machines, const std::uint64_t cycles)
+    {
+        for (c8::Machine& machine : machines) {
+            for (std::uint64_t remaining = cycles; remaining > 0;) {
+                const int chunk = static_cast<int>(std::min<std::uint64_t>(remaining, 1 << 30));
+
+                machine.executeClockCycles(chunk);
+                remaining -= chunk;
+            }
+        }
+    }
+
+    LockstepMeasurement measureLockstep(const Workload& workload, const Options& options)
+    {
+        using clock = std::chrono::steady_clock;
+
+        LockstepMeasurement measurement;
+
+        measurement.name = workload.name;
+        measurement.lanes = options.lanes;
+
+        const std::string rom{workload.rom.begin(), workload.rom.end()};
+        const std::uint64_t cycles = std::max<std::uint64_t>(1, options.instructions / options.lanes);
+
+        std::vector<double> batchMips;
+        std::vector<double> machinesMips;
+        std::vector<double> arenaMips;
+
+        const std::size_t arenaSize = c8::arena::Arena::getRequiredSize(options.lanes, true);
+
+        std::vector<CacheLine> arenaMemory((arenaSize + sizeof(CacheLine) - 1) / sizeof(CacheLine));
+
+        for (int i = 0; i < options.repetitions; i++) {
+            std::istringstream romStream{rom};
+
+            c8::lockstep::Batch batch{options.lanes, romStream, 1};
+
+            auto start = clock::now();
+
+            batch.step(cycles);
+
+            const std::chrono::duration<double> batchTime = clock::now() - start;
+
+            std::deque<c8::Machine> machines;
+            std::deque<c8::Machine> arenaMachines;
+
+            for (std::size_t lane = 0; lane < options.lanes; lane++) {
+                const std::uint32_t seed = 1 + static_cast<std::uint32_t>(lane);
+
+                // Loaded the way Batch loads its lanes, from a stream
+                for (std::deque<c8::Machine>* copies : {&machines, &arenaMachines}) {
+                    std::istringstream programStream{rom};
+
+                    copies->emplace_back(0, seed).loadProgram(programStream);
+                }
+            }
+
+            start = clock::now();
+
+            runMachines(machines, cycles);
+
+            const std::chrono::duration<double> machinesTime = clock::now() - start;
+
+            std::vector<c8::Machine*> arenaPointers;
+
+            for (c8::Machine& machine : arenaMachines) {
+                arenaPointers.push_back(&machine);
+            }
+
+            c8::arena::Arena arena{arenaMemory.data(), arenaMemory.size() * sizeof(CacheLine), options.lanes, true};
+
+            measurement.matches = measurement.matches && arena.attach(arenaPointers);
+
+            start = clock::now();
+
+            runMachines(arenaMachines, cycles);
+
+            const std::chrono::duration<double> arenaTime = clock::now() - start;
+
+            std::uint64_t instructions = 0;
+
+            for (std::size_t lane = 0; lane < options.lanes; lane++) {
+                const c8::Machine& laneMachine = batch.syncMachine(lane);
+                const std::uint64_t* arenaRows = arena.getRows() + lane * c8::vga::frameBufferHeight;
+
+                instructions += machines[lane].getTotalCpuCycles();
+
+                measurement.matches = measurement.matches
+                    && laneMachine.getTotalCpuCycles() == machines[lane].getTotalCpuCycles()
+                    && hashState(laneMachine) == hashState(machines[lane])
+                    && std::equal(arenaRows, arenaRows + c8::vga::frameBufferHeight, machines[lane].getVgaState().getRows())
+                    && hashState(arenaMachines[lane]) == hashState(machines[lane]);
+            }
+
+            measurement.matches = measurement.matches && arena.detach(arenaPointers);
+
+            batchMips.push_back(instructions / batchTime.count() / 1e6);
+            machinesMips.push_back(instructions / machinesTime.count() / 1e6);
+            arenaMips.push_back(instructions / arenaTime.count() / 1e6);
+
+            const c8::lockstep::Stats& stats = batch.getStats();
+            const std::uint64_t laneSteps = stats.vectorLaneSteps + stats.scalarLaneSteps + stats.machineLaneSteps;
+
+            measurement.vectorShare = laneSteps > 0 ? static_cast<double>(stats.vectorLaneSteps) / laneSteps : 0;
+        }
+
+        std::sort(batchMips.begin(), batchMips.end());
+        std::sort(machinesMips.begin(), machinesMips.end());
+        std::sort(arenaMips.begin(), arenaMips.end());
+
+        measurement.batchMips = batchMips[batchMips.size() / 2];
+        measurement.machinesMips = machinesMips[machinesMips.size() / 2];
+        measurement.arenaMips = arenaMips[arenaMips.size() / 2];
+
+        return measurement;
+    }
+
+    void writeText(std::ostream& out, const std::vector<Measurement>& measurements)
+    {
+        out << std::left << std::setw(10) << "workload" << std::right
+            << std::setw(14) << "instructions"
+            << std::setw(12) << "median MIPS"
+            << std::setw(12) << "best MIPS"
+            << std::setw(14) << "host/instr"
+            << std::setw(8) << "allocs"
+            << std::setw(20) << "frame hash"
+            << std::setw(20) << "state hash" << "\n";
+
+        for (const Measurement& measurement : measurements) {
+            out << std::left << std::setw(10) << measurement.name << std::right
+                << std::setw(14) << measurement.instructions
+                << std::fixed << std::setprecision(1)
+                << std::setw(12) << measurement.medianMips
+                << std::setw(12) << measurement.bestMips;
+
+            if (measurement.hostInstructionsPerInstruction > 0) {
+                out << std::setw(14) << measurement.hostInstructionsPerInstruction;
+            } else {
+                out << std::setw(14) << "-";
+            }
+
+            out << std::defaultfloat
+                << std::setw(8) << measurement.allocations
+                << "  0x" << std::hex << std::uppercase << std::setw(16) << std::setfill('0') << measurement.frameHash
+                << "  0x" << std::setw(16) << measurement.stateHash
+                << std::dec << std::nouppercase << std::setfill(' ') << "\n";
+        }
+    }
+
+    void writeLockstepText(std::ostream& out, const std::vector<LockstepMeasurement>& measurements, const bool usingAvx2)
+    {
+        out << "\nlockstep::Batch and Machines in an arena::Arena against Machines run one after the other"
+            << (usingAvx2 ? "" : ", without AVX2 the batch runs its Machines") << "\n";
+
+        out << std::left << std::setw(10) << "workload" << std::right
+            << std::setw(8) << "lanes"
+            << std::setw(12) << "batch MIPS"
+            << std::setw(15) << "machines MIPS"
+            << std::setw(12) << "arena MIPS"
+            << std::setw(10) << "vector"
+            << std::setw(8) << "match" << "\n";
+
+        for (const LockstepMeasurement& measurement : measurements) {
+            out << std::left << std::setw(10) << measurement.name << std::right
+                << std::setw(8) << measurement.lanes
+                << std::fixed << std::setprecision(1)
+                << std::setw(12) << measurement.batchMips
+                << std::setw(15) << measurement.machinesMips
+                << std::setw(12) << measurement.arenaMips
+                << std::setw(9) << 100 * measurement.vectorShare << "%"
+                << std::defaultfloat
+                << std::setw(8) << (measurement.matches ? "yes" : "NO") << "\n";
+        }
+    }
+
+    void writeJson(
+        std::ostream& out,
+        const std::vector<Measurement>& measurements,
+        const std::vector<LockstepMeasurement>& lockstepMeasurements,
+        const Options& options,
+        const bool hasCounter)
+    {
+        out << "{\n";
+        out << "  \"context\": {\n";
+        out << "    \"instructions\": " << options.instructions << ",\n";
+        out << "    \"repetitions\": " << options.repetitions << ",\n";
+        out << "    \"lanes\": " << options.lanes << ",\n";
+        out << "    \"avx2\": " << (c8::lockstep::cpuSupportsAvx2() ? "true" : "false") << ",\n";
+        out << "    \"hardware_counters\": " << (hasCounter ? "true" : "false") << ",\n";
+        out << "    \"compiler\": \"" << __VERSION__ << "\"\n";
+        out << "  },\n";
+        out << "  \"workloads\": [";
+
+        for (std::size_t i = 0; i < measurements.size(); i++) {
+            const Measurement& measurement = measurements[i];
+
+            out << (i == 0 ? "\n" : ",\n");
+            out << "    {\"name\": \"" << measurement.name << "\""
+                << ", \"instructions\": " << measurement.instructions
+                << ", \"median_mips\": " << measurement.medianMips
+                << ", \"best_mips\": " << measurement.bestMips
+                << ", \"host_instructions_per_instruction\": ";
+
+            if (hasCounter) {
+                out << measurement.hostInstructionsPerInstruction;
+            } else {
+                out << "null";
+            }
+
+            out << ", \"allocations\": " << measurement.allocations
+                << ", \"frame_hash\": " << measurement.frameHash
+                << ", \"state_hash\": " << measurement.stateHash << "}";
+        }
+
+        out << "\n  ],\n";
+        out << "  \"lockstep\": [";
+
+        for (std::size_t i = 0; i < lockstepMeasurements.size(); i++) {
+            const LockstepMeasurement& measurement = lockstepMeasurements[i];
+
+            out << (i == 0 ? "\n" : ",\n");
+            out << "    {\"name\": \"" << measurement.name << "\""
+                << ", \"lanes\": " << measurement.lanes
+                << ", \"batch_mips\": " << measurement.batchMips
+                << ", \"machines_mips\": " << measurement.machinesMips
+                << ", \"arena_mips\": " << measurement.arenaMips
+                << ", \"vector_share\": " << measurement.vectorShare
+                << ", \"matches\": " << (measurement.matches ? "true" : "false") << "}";
+        }
+
+        out << (lockstepMeasurements.empty() ? "" : "\n  ") << "]\n}\n";
+    }
+
+    int run(int argc, char** argv)
+    {
+        Options options;
+
+        if (!parseArgs(argc, argv, options)) {
+            std::cerr << "Usage: " << argv[0] << " [--instructions N] [--repetitions N] [--lanes N] [--filter text] [--json file]\n";
+            return 1;
+        }
+
+        // Only instructions, so the count never has to be multiplexed
+        c8::perf::CounterGroup counter{{false, true, false, false}};
+
+        std::vector<Measurement> measurements;
+        std::vector<LockstepMeasurement> lockstepMeasurements;
+
+        for (const Workload& workload : makeWorkloads()) {
+            if (workload.name.find(options.filter) == std::string::npos) {
+                continue;
+            }
+
+            measurements.push_back(measure(workload, options, counter));
+
+            if (options.lanes > 0) {
+                lockstepMeasurements.push_back(measureLockstep(workload, options));
+            }
+        }
+
+        if (options.jsonPath == "-") {
+            writeJson(std::cout, measurements, lockstepMeasurements, options, counter.isAvailable());
+            return 0;
+        }
+
+        writeText(std::cout, measurements);
+
+        if (!counter.isAvailable()) {
+            std::cout << "host/instr needs perf_event_open, which is not available here\n";
+        }
+
+        if (!lockstepMeasurements.empty()) {
+            writeLockstepText(std::cout, lockstepMeasurements, c8::lockstep::cpuSupportsAvx2());
+        }
+
+        if (options.jsonPath.empty()) {
+            return 0;
+        }
+
+        std::ofstream out{options.jsonPath};
+
+        if (!out.is_open()) {
+            std::cerr << "Could not open " << options.jsonPath << "\n";
+            return 1;
+        }
+
+        writeJson(out, measurements, lockstepMeasurements, options, counter.isAvailable());
+
+        return 0;
+    }
+}
@@ -0,0 +1,55 @@
+/**
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace c8::throughput
+{
+    /**
+     * A generated ROM that stresses one part of the interpreter
+    */
+    struct Workload
+    {
+        std::string name;
+        std::string description;
+
+        std::vector<std::uint8_t> rom;
+    };
+
+    /**
+     * The stress ROMs, generated the same way on every build so results
+     * stay comparable across commits: ALU loops, draw loops, CALL/RET
+     * recursion, Fx55/Fx65 memory copies and self-modifying code
+    */
+    std::vector<Workload> makeWorkloads();
+
+    /**
+     * Runs each workload headless for a fixed number of instructions and
+     * reports emulated MIPS, host instructions per emulated instruction
+     * (where hardware counters are available) and heap allocations made
+     * while running. Each workload is then run in --lanes copies by a
+     * lockstep::Batch, by as many Machines one after the other, and by as
+     * many Machines with their state in an arena::Arena, to compare their
+     * speed and check that all three end in the same states.
+     * Returns the process exit code.
+     *
+     * Usage: [--instructions N] [--repetitions N] [--lanes N] [--filter text] [--json file]
+    */
+    int run(int argc, char** argv);
+}
@@ -0,0 +1,134 @@
+/**
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "trace.hpp"
+
+#include <chrono>
+
+namespace c8::trace
+{
+    // Records written to the file at once
+    constexpr std::size_t writeBatchSize = 4096;
+
+    std::size_t Recorder::take(Record* out, const std::size_t maxCount)
+    {
+        return queue.popMany(out, maxCount);
+    }
+
+    std::uint64_t Recorder::getDroppedCount() const
+    {
+        return dropped.load(std::memory_order_relaxed);
+    }
+
+    Writer::Writer(Recorder& recorder, const std::string& path) :
+        recorder(recorder),
+        file(path, std::ios::binary),
+        batch(writeBatchSize)
+    {
+        if (!file.is_open()) {
+            return;
+        }
+
+        // Rewritten with the final counts when the writer stops
+        const FileHeader header;
+
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+        thread = std::thread{&Writer::run, this};
+    }
+
+    Writer::~Writer()
+    {
+        if (!thread.joinable()) {
+            return;
+        }
+
+        running.store(false, std::memory_order_relaxed);
+        thread.join();
+
+        drain();
+
+        FileHeader header;
+
+        header.recordCount = recordCount;
+        header.droppedCount = recorder.getDroppedCount();
+
+        file.seekp(0);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    }
+
+    bool Writer::isOpen() const
+    {
+        return file.is_open();
+    }
+
+    std::size_t Writer::drain()
+    {
+        std::size_t total = 0;
+
+        while (true) {
+            const std::size_t count = recorder.take(batch.data(), batch.size());
+
+            if (count == 0) {
+                return total;
+            }
+
+            file.write(reinterpret_cast<const char*>(batch.data()), count * sizeof(Record));
+
+            recordCount += count;
+            total += count;
+        }
+    }
+
+    void Writer::run()
+    {
+        while (running.load(std::memory_order_relaxed)) {
+            // Only sleep while the emulation produces records slowly, a
+            // free running machine fills the queue in about a millisecond
+            if (drain() < queueCapacity / 4) {
+                std::this_thread::sleep_for(std::chrono::milliseconds{1});
+            }
+        }
+    }
+
+    Reader::Reader(const std::string& path) :
+        file(path, std::ios::binary)
+    {
+        if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+            return;
+        }
+
+        const FileHeader expected;
+
+        valid = header.magic == expected.magic
+            && header.version == fileVersion
+            && header.recordSize == sizeof(Record);
+    }
+
+    bool Reader::isValid() const
+    {
+        return valid;
+    }
+
+    const FileHeader& Reader::getHeader() const
+    {
+        return header;
+    }
+
+    bool Reader::next(Record& record)
+    {
+        return valid && file.read(reinterpret_cast<char*>(&record), sizeof(record));
+    }
+}
@@ -0,0 +1,220 @@
+/**
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cpu.hpp"
+#include "sync.hpp"
+
+namespace c8::trace
+{
+    inline constexpr std::uint32_t fileVersion = 1;
+
+    // Record::reg when no V register changed, and the flag set when more
+    // than the one given changed
+    inline constexpr std::uint8_t noRegister = 0xFF;
+    inline constexpr std::uint8_t multipleRegisters = 0x10;
+
+    // Records the emulation thread can be ahead of the writer before
+    // records are dropped
+    inline constexpr std::size_t queueCapacity = 1 << 17;
+
+    /**
+     * One executed instruction, with the state after it
+    */
+    struct Record
+    {
+        std::uint64_t cycle;
+
+        std::uint16_t pc;
+        std::uint16_t word;
+        std::uint16_t ir;
+
+        // Index of the lowest V register the instruction changed, plus
+        // multipleRegisters if others changed too, or noRegister
+        std::uint8_t reg;
+
+        // New value of that register
+        std::uint8_t value;
+    };
+
+    static_assert(sizeof(Record) == 16);
+
+    /**
+     * Start of a trace file, followed by the records
+    */
+    struct FileHeader
+    {
+        std::array<char, 4> magic = {'C', '8', 'T', 'R'};
+
+        std::uint32_t version = fileVersion;
+        std::uint32_t recordSize = sizeof(Record);
+        std::uint32_t reserved = 0;
+
+        std::uint64_t recordCount = 0;
+        std::uint64_t droppedCount = 0;
+    };
+
+    /**
+     * Counter policy for Machine::executeClockCycle that produces a Record
+     * per executed instruction into a lock-free queue. Nothing waits on the
+     * reader, records that do not fit are dropped and counted.
+    */
+    class Recorder
+    {
+    private:
+        c8::sync::SpscQueue<Record, queueCapacity> queue;
+
+        Record pending{};
+
+        std::array<std::uint8_t, 16> lastV{};
+
+        std::uint64_t cycle = 0;
+
+        std::atomic<std::uint64_t> dropped{0};
+
+    public:
+        static constexpr bool enabled = true;
+
+        void count(const std::uint16_t pc, const std::uint16_t word)
+        {
+            pending.cycle = cycle++;
+            pending.pc = pc;
+            pending.word = word;
+        }
+
+        void executed(const c8::cpu::CpuState& state)
+        {
+            std::uint64_t before[2];
+            std::uint64_t after[2];
+
+            std::memcpy(before, lastV.data(), sizeof(before));
+            std::memcpy(after, state.v.data(), sizeof(after));
+
+            // One bit set per changed byte, as the high bit of the byte
+            std::uint64_t changed[2] = {before[0] ^ after[0], before[1] ^ after[1]};
+
+            pending.reg = noRegister;
+            pending.value = 0;
+
+            for (int half = 0; half < 2 && pending.reg == noRegister; half++) {
+                if (changed[half] == 0) {
+                    continue;
+                }
+
+                const int byte = std::countr_zero(changed[half]) / 8;
+                const int index = half * 8 + byte;
+
+                changed[half] &= ~(std::uint64_t{0xFF} << (byte * 8));
+
+                pending.reg = static_cast<std::uint8_t>(index);
+                pending.value = state.v[index];
+
+                if (changed[0] != 0 || changed[1] != 0) {
+                    pending.reg |= multipleRegisters;
+                }
+            }
+
+            pending.ir = state.ir;
+            lastV = state.v;
+
+            // Only this thread writes dropped, so no read-modify-write
+            if (!queue.push(pending)) {
+                dropped.store(dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            }
+        }
+
+        /**
+         * Called by the reader, returns how many records were taken
+        */
+        std::size_t take(Record* out, const std::size_t maxCount);
+
+        std::uint64_t getDroppedCount() const;
+    };
+
+    /**
+     * Streams the records of a Recorder to a file from a background thread
+     * until it is destroyed
+    */
+    class Writer
+    {
+    private:
+        Recorder& recorder;
+
+        std::ofstream file;
+
+        std::atomic<bool> running{true};
+
+        std::uint64_t recordCount = 0;
+
+        // Records on their way from the queue to the file
+        std::vector<Record> batch;
+
+        std::thread thread;
+
+        /**
+         * Writes every queued record, returns how many
+        */
+        std::size_t drain();
+
+        void run();
+
+    public:
+        Writer(Recorder& recorder, const std::string& path);
+
+        ~Writer();
+
+        Writer(const Writer&) = delete;
+        Writer& operator=(const Writer&) = delete;
+
+        bool isOpen() const;
+    };
+
+    /**
+     * Reads a trace file written by Writer. Returns false if it is not
+     * one.
+    */
+    class Reader
+    {
+    private:
+        std::ifstream file;
+
+        FileHeader header;
+
+        bool valid = false;
+
+    public:
+        explicit Reader(const std::string& path);
+
+        bool isValid() const;
+
+        const FileHeader& getHeader() const;
+
+        /**
+         * Returns false at the end of the file
+        */
+        bool next(Record& record);
+    };
+}
@@ -0,0 +1,202 @@
+/**
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <array>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "opcodes.hpp"
+#include "trace.hpp"
+
+// Decodes, filters and disassembles a trace written with --trace.
+//
+// Usage: c8-trace [--pc addr[-addr]] [--opcode name] [--cycles from[-to]]
+//                 [--register x] [--limit N] file
+//
+// Addresses and registers are in hex, name is an Opcode identifier such as
+// DRW_Vx_Vy_Nibble or a mnemonic such as DRW, which selects every Opcode
+// starting with it. --opcode may be given more than once.
+
+struct Options
+{
+    std::string tracePath;
+
+    std::uint16_t pcFrom = 0;
+    std::uint16_t pcTo = 0xFFFF;
+
+    std::uint64_t cycleFrom = 0;
+    std::uint64_t cycleTo = UINT64_MAX;
+
+    // Indexed like getOpcodeIdentifier, the Opcode value plus one
+    std::array<bool, c8::opcodes::opcodeCount> opcodes{};
+
+    bool filterOpcodes = false;
+
+    int reg = -1;
+
+    std::uint64_t limit = UINT64_MAX;
+};
+
+// Parses "from" or "from-to", a single value is a range of one
+template <typename T>
+void parseRange(const std::string& text, const int base, T& from, T& to)
+{
+    const std::size_t dash = text.find('-');
+
+    from = static_cast<T>(std::stoull(text.substr(0, dash), nullptr, base));
+    to = dash == std::string::npos ? from : static_cast<T>(std::stoull(text.substr(dash + 1), nullptr, base));
+}
+
+// Selects every Opcode whose identifier or mnemonic is name, returns
+// false if there is none
+bool selectOpcodes(const std::string& name, Options& options)
+{
+    bool found = false;
+
+    for (int i = 0; i < c8::opcodes::opcodeCount; i++) {
+        const std::string_view identifier = c8::opcodes::getOpcodeIdentifier(static_cast<c8::opcodes::Opcode>(i - 1));
+
+        if (identifier == name || identifier.substr(0, identifier.find('_')) == name) {
+            options.opcodes[i] = true;
+            found = true;
+        }
+    }
+
+    options.filterOpcodes = true;
+
+    return found;
+}
+
+bool parseArgs(int argc, char** argv, Options& options)
+{
+    std::vector<std::string> args;
+
+    args.assign(argv + 1, argv + argc);
+
+    for (std::size_t i = 0; i < args.size(); i++) {
+        const std::string& arg = args[i];
+
+        if (arg == "--pc" && i + 1 < args.size()) {
+            parseRange(args[++i], 16, options.pcFrom, options.pcTo);
+            continue;
+        }
+
+        if (arg == "--cycles" && i + 1 < args.size()) {
+            parseRange(args[++i], 10, options.cycleFrom, options.cycleTo);
+            continue;
+        }
+
+        if (arg == "--opcode" && i + 1 < args.size()) {
+            if (!selectOpcodes(args[++i], options)) {
+                std::cerr << "Unknown opcode " << args[i] << "\n";
+                return false;
+            }
+
+            continue;
+        }
+
+        if (arg == "--register" && i + 1 < args.size()) {
+            options.reg = std::stoi(args[++i], nullptr, 16);
+            continue;
+        }
+
+        if (arg == "--limit" && i + 1 < args.size()) {
+            options.limit = std::stoull(args[++i]);
+            continue;
+        }
+
+        options.tracePath = arg;
+    }
+
+    return !options.tracePath.empty();
+}
+
+bool matches(const c8::trace::Record& record, const Options& options)
+{
+    if (record.pc < options.pcFrom || record.pc > options.pcTo) {
+        return false;
+    }
+
+    if (record.cycle < options.cycleFrom || record.cycle > options.cycleTo) {
+        return false;
+    }
+
+    if (options.filterOpcodes && !options.opcodes[static_cast<int>(c8::opcodes::decode(record.word)) + 1]) {
+        return false;
+    }
+
+    // Only the lowest changed register is recorded
+    if (options.reg >= 0 && (record.reg == c8::trace::noRegister || (record.reg & 0xF) != options.reg)) {
+        return false;
+    }
+
+    return true;
+}
+
+void printRecord(const c8::trace::Record& record)
+{
+    std::cout << std::setw(12) << std::setfill(' ') << record.cycle << std::hex << std::uppercase << std::setfill('0')
+              << "  0x" << std::setw(4) << record.pc
+              << "  " << std::setw(4) << record.word
+              << "  " << std::left << std::setw(20) << std::setfill(' ') << c8::opcodes::getOpcodeName(record.word) << std::right
+              << "  I=0x" << std::setw(4) << std::setfill('0') << record.ir;
+
+    if (record.reg != c8::trace::noRegister) {
+        std::cout << "  V" << (record.reg & 0xF) << "=0x" << std::setw(2) << static_cast<int>(record.value);
+
+        if (record.reg & c8::trace::multipleRegisters) {
+            std::cout << " +";
+        }
+    }
+
+    std::cout << std::dec << std::nouppercase << std::setfill(' ') << "\n";
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+
+    if (!parseArgs(argc, argv, options)) {
+        std::cerr << "Usage: " << argv[0] << " [--pc addr[-addr]] [--opcode name] [--cycles from[-to]] [--register x] [--limit N] file\n";
+        return 1;
+    }
+
+    c8::trace::Reader reader{options.tracePath};
+
+    if (!reader.isValid()) {
+        std::cerr << options.tracePath << " is not a c8 trace\n";
+        return 1;
+    }
+
+    std::cout << "# " << reader.getHeader().recordCount << " records, "
+              << reader.getHeader().droppedCount << " dropped\n";
+
+    c8::trace::Record record;
+
+    std::uint64_t printed = 0;
+
+    while (printed < options.limit && reader.next(record)) {
+        if (matches(record, options)) {
+            printRecord(record);
+            printed++;
+        }
+    }
+
+    return 0;
+}
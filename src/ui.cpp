@@ -14,30 +14,135 @@
 */
 
 #include <memory>
+#include <array>
 
 #include <SFML/Graphics.hpp>
 #include <optional>
 
 #include "ui.hpp"
 #include "cpu.hpp"
+#include "allocations.hpp"
+#include "counters.hpp"
+#include "opcodes.hpp"
 #include "fonts.hpp"
 #include "config.hpp"
+#include "memory.hpp"
+#include "perf.hpp"
+#include "phases.hpp"
+#include "vga.hpp"
 
 namespace c8::ui
 {
     constexpr int emulatorInfoWidth = 500;
-    constexpr int emulatorInfoHeight = 500;
+    constexpr int emulatorInfoHeight = 580;
 
     std::unique_ptr<sf::RenderWindow> window;
 
+    constexpr unsigned int characterSize = 18;
+    constexpr int tabWidth = 4;
+
     sf::Font font;
 
+    // The pacing stats, one line per host phase, the allocation counts when
+    // they are tracked, then with --perf one line per hardware counter
+    constexpr int statsPacingLineCount = 4;
+    constexpr int statsAllocationsFirstLine = statsPacingLineCount + c8::phases::phaseCount;
+    constexpr int statsPerfFirstLine = statsAllocationsFirstLine + (c8::allocations::tracking ? 3 : 0);
+    constexpr int statsOverlayLineCount = statsPerfFirstLine + c8::perf::counterCount;
+
+    bool showStatsOverlay = false;
+    bool showHeatmap = false;
+
+    // Size of one address in the heatmap panel, drawn in the top right
+    // corner of the display
+    constexpr int heatmapCellSize = 4;
+    constexpr int heatmapPanelSize = c8::mem::heatmapSide * heatmapCellSize;
+
+    int hostFps = 0;
+
+    c8::allocations::Counts renderFrameAllocations;
+
+    // The memory listing drawn last is centered on this, clicking one of its
+    // lines toggles a breakpoint at the address shown there
+    std::uint16_t listingPc = 0;
+
+    float getInfoPanelTop()
+    {
+        return static_cast<float>(c8::config::getRenderHeight() + 10);
+    }
+
+    // Kept between frames, creating textures and shapes every frame
+    // allocated
+    sf::RenderTexture vgaTexture;
+    sf::RenderTexture cpuInfoTexture;
+    sf::RenderTexture memoryTexture;
+
+    sf::VertexArray vgaPixels{sf::PrimitiveType::Triangles};
+    sf::RectangleShape statsOverlayBackground;
+
+    // Two triangles per address, only the colors change after initialize()
+    sf::VertexArray heatmapCells{sf::PrimitiveType::Triangles, c8::mem::maxBufferSize * 6};
+
+    void buildHeatmapCells()
+    {
+        const float panelLeft = static_cast<float>(c8::config::getRenderWidth() - heatmapPanelSize);
+
+        for (int addr = 0; addr < c8::mem::maxBufferSize; addr++) {
+            const float left = panelLeft + (addr % c8::mem::heatmapSide) * heatmapCellSize;
+            const float top = static_cast<float>((addr / c8::mem::heatmapSide) * heatmapCellSize);
+            const float right = left + heatmapCellSize;
+            const float bottom = top + heatmapCellSize;
+
+            sf::Vertex* vertices = &heatmapCells[addr * 6];
+
+            vertices[0].position = {left, top};
+            vertices[1].position = {right, top};
+            vertices[2].position = {left, bottom};
+            vertices[3].position = {left, bottom};
+            vertices[4].position = {right, top};
+            vertices[5].position = {right, bottom};
+        }
+    }
+
+    // Every printable ASCII glyph is rasterised into the font texture up front,
+    // so the texture never changes after initialize() and the cached vertex
+    // arrays of a TextPanel stay valid.
+    std::array<sf::Glyph, 128> glyphAtlas;
+    const sf::Texture* glyphAtlasTexture = nullptr;
+    float lineSpacing = 0;
+
+    void buildGlyphAtlas()
+    {
+        for (char32_t c = ' '; c <= '~'; c++) {
+            glyphAtlas[c] = font.getGlyph(c, characterSize, false);
+        }
+
+        glyphAtlasTexture = &font.getTexture(characterSize);
+        lineSpacing = font.getLineSpacing(characterSize);
+    }
+
     void initialize()
     {
         if (!font.openFromMemory(&c8::fonts::courierFontData, c8::fonts::courierFontDataLength)){
             return;
         }
 
+        buildGlyphAtlas();
+
+        bool success = true;
+
+        success = success && vgaTexture.resize({c8::config::getRenderWidth(), c8::config::getRenderHeight()});
+        success = success && cpuInfoTexture.resize({emulatorInfoWidth, emulatorInfoHeight});
+        success = success && memoryTexture.resize({emulatorInfoWidth, emulatorInfoHeight});
+
+        if (!success) {
+            return;
+        }
+
+        statsOverlayBackground.setFillColor(sf::Color{0, 0, 0, 192});
+
+        buildHeatmapCells();
+
         const unsigned int height = c8::config::showEmulatorInfo ? 
             c8::config::getRenderHeight() + emulatorInfoHeight : 
             c8::config::getRenderHeight();
@@ -47,33 +152,96 @@ namespace c8::ui
         window = std::make_unique<sf::RenderWindow>(vm, "c8");
     }
 
-    void processKeyPressed(const sf::Event::KeyPressed* keyPress)
+    void setFps(const int fps)
+    {
+        hostFps = fps;
+    }
+
+    void setRenderAllocations(const c8::allocations::Counts& counts)
+    {
+        renderFrameAllocations = counts;
+    }
+
+    void setVerticalSyncEnabled(const bool enabled)
+    {
+        if (window != nullptr) {
+            window->setVerticalSyncEnabled(enabled);
+        }
+    }
+
+    void processKeyPressed(
+        const sf::Event::KeyPressed* keyPress, 
+        c8::cpu::CommandQueue& commands)
     {
         const sf::Keyboard::Key key = keyPress->code;
 
+        if (key == sf::Keyboard::Key::O) {
+            showStatsOverlay = !showStatsOverlay;
+            return;
+        }
+
+        if (key == sf::Keyboard::Key::H) {
+            showHeatmap = !showHeatmap;
+            return;
+        }
+
         if (key == sf::Keyboard::Key::P) { 
-            c8::cpu::togglePaused();
+            commands.push({c8::cpu::CommandType::TogglePaused, 0});
             return;
         }
 
         if (key == sf::Keyboard::Key::Right) {
-            c8::cpu::advanceOneClockCycle();
+            commands.push({c8::cpu::CommandType::Step, 0});
             return;
         }
 
         if (key == sf::Keyboard::Key::Left) {
-            c8::cpu::backOneClockCylce();
+            commands.push({c8::cpu::CommandType::StepBack, 0});
             return;
         }
 
         if (valueByKey.contains(key)) {
-            std::uint8_t value = valueByKey.at(key);
-            c8::cpu::keyboardKeyPressed(value);
+            commands.push({c8::cpu::CommandType::KeyDown, valueByKey.at(key)});
             return;
         }
     }
 
-    void pollInput()
+    void processKeyReleased(
+        const sf::Event::KeyReleased* keyRelease, 
+        c8::cpu::CommandQueue& commands)
+    {
+        const sf::Keyboard::Key key = keyRelease->code;
+
+        if (valueByKey.contains(key)) {
+            commands.push({c8::cpu::CommandType::KeyUp, valueByKey.at(key)});
+        }
+    }
+
+    void processMouseButtonPressed(
+        const sf::Event::MouseButtonPressed* buttonPress,
+        c8::cpu::CommandQueue& commands)
+    {
+        if (!c8::config::showEmulatorInfo || buttonPress->button != sf::Mouse::Button::Left) {
+            return;
+        }
+
+        const sf::Vector2f position = window->mapPixelToCoords(buttonPress->position);
+
+        // The memory panel is the left one below the display
+        if (position.x < 0 || position.x >= emulatorInfoWidth || position.y < getInfoPanelTop()) {
+            return;
+        }
+
+        const int line = static_cast<int>((position.y - getInfoPanelTop()) / lineSpacing);
+
+        if (line >= c8::mem::listingLineCount) {
+            return;
+        }
+
+        commands.push({c8::cpu::CommandType::ToggleBreakpoint, 0, c8::mem::getListingAddress(listingPc, line)});
+    }
+
+    void pollInput(c8::cpu::CommandQueue& commands)
     {
         while (const std::optional<sf::Event> event = window->pollEvent()) {
             if (event->is<sf::Event::Closed>()) {
@@ -82,11 +250,12 @@ namespace c8::ui
             }
 
             if (const auto* keyPress = event->getIf<sf::Event::KeyPressed>()) {
-                processKeyPressed(keyPress);
-                break;
-            }
-
-            if (const auto* resize = event->getIf<sf::Event::Resized>()) {
+                processKeyPressed(keyPress, commands);
+            } else if (const auto* keyRelease = event->getIf<sf::Event::KeyReleased>()) {
+                processKeyReleased(keyRelease, commands);
+            } else if (const auto* buttonPress = event->getIf<sf::Event::MouseButtonPressed>()) {
+                processMouseButtonPressed(buttonPress, commands);
+            } else if (const auto* resize = event->getIf<sf::Event::Resized>()) {
                 sf::View view = window->getDefaultView();
 
                 view.setSize({
@@ -95,39 +264,312 @@ namespace c8::ui
                 });
 
                 window->setView(view);
+            }
+        }
+    }
+
+    constexpr int cpuInfoLineCount = 27;
+
+    TextPanel cpuInfoPanel{cpuInfoLineCount};
+
+    void setRegisterPairLine(
+        c8::format::Line& line,
+        const int index,
+        const c8::cpu::Snapshot& snapshot)
+    {
+        const int upperIndex = index + 8;
+
+        line.clear()
+            .append("V").appendHexDigits(index, 1).append(" = ").appendHex(snapshot.v[index])
+            .append("\tV").appendHexDigits(upperIndex, 1).append(" = ").appendHex(snapshot.v[upperIndex]);
+    }
+
+    c8::format::Line& appendMilliseconds(c8::format::Line& line, const std::chrono::microseconds duration)
+    {
+        const auto us = duration.count();
+
+        return line.appendDec(us / 1000).append('.').appendDec((us % 1000) / 10, 2);
+    }
+
+    c8::format::Line& appendHundredths(c8::format::Line& line, const long long hundredths)
+    {
+        return line.appendDec(hundredths / 100).append('.').appendDec(hundredths % 100, 2);
+    }
+
+    // Wide enough for the longest Opcode identifier and its share
+    constexpr std::size_t topOpcodeColumnWidth = 22;
+
+    void setTopCountersLine(
+        c8::format::Line& line,
+        const int index,
+        const c8::cpu::Snapshot& snapshot)
+    {
+        const c8::counters::TopEntry& opcode = snapshot.topOpcodes[index];
+        const c8::counters::TopEntry& address = snapshot.topAddresses[index];
+
+        const std::uint64_t total = snapshot.countedInstructions;
+
+        line.clear();
+
+        if (opcode.count > 0) {
+            line.append(c8::opcodes::getOpcodeIdentifier(static_cast<c8::opcodes::Opcode>(opcode.key)))
+                .append(' ').appendDec(static_cast<long long>(100 * opcode.count / total)).append('%');
+        }
+
+        while (line.size() < topOpcodeColumnWidth) {
+            line.append(' ');
+        }
+
+        if (address.count > 0) {
+            line.appendHex(static_cast<std::uint16_t>(address.key), false)
+                .append(' ').appendDec(static_cast<long long>(100 * address.count / total)).append('%');
+        }
+    }
+
+    void renderCpuInfo(sf::RenderTexture& texture, const c8::cpu::Snapshot& snapshot)
+    {
+        c8::format::Line line;
+
+        line.clear().append("PC = ").appendHex(snapshot.pc).append("\tI = ").appendHex(snapshot.ir);
+        cpuInfoPanel.setLine(0, line);
+
+        line.clear().append("DT = ").appendHex(snapshot.dt).append("\tST = ").appendHex(snapshot.st);
+        cpuInfoPanel.setLine(2, line);
+
+        for (int i = 0; i < 8; i++) {
+            setRegisterPairLine(line, i, snapshot);
+            cpuInfoPanel.setLine(4 + i, line);
+        }
+
+        line.clear().append("Emulator State = ").append(snapshot.paused ? "PAUSED" : "RUNNING");
+        cpuInfoPanel.setLine(13, line);
+
+        line.clear().append("Current CPU State = ").appendDec(snapshot.cpuStateDisplayIndex).append('/').appendDec(c8::cpu::maxCpuStates);
+        cpuInfoPanel.setLine(14, line);
+
+        line.clear().append("CPU Frequency = ").appendDec(snapshot.cpuHertz).append("Hz");
+        cpuInfoPanel.setLine(15, line);
+
+        line.clear().append("Render Speed = ").appendDec(hostFps).append("FPS");
+        cpuInfoPanel.setLine(16, line);
 
-                break;
+        line.clear().append("Frame p50/p99 = ");
+        appendMilliseconds(line, snapshot.frameIntervalP50).append(" / ");
+        appendMilliseconds(line, snapshot.frameIntervalP99).append("ms");
+        cpuInfoPanel.setLine(17, line);
+
+        if (snapshot.countedInstructions > 0) {
+            line.clear().append("Top instructions");
+
+            while (line.size() < topOpcodeColumnWidth) {
+                line.append(' ');
+            }
+
+            cpuInfoPanel.setLine(19, line.append("Top addresses"));
+
+            for (int i = 0; i < c8::counters::topCount; i++) {
+                setTopCountersLine(line, i, snapshot);
+                cpuInfoPanel.setLine(20 + i, line);
             }
         }
+
+        cpuInfoPanel.setLine(24, line.clear().append("Controls:"));
+        cpuInfoPanel.setLine(25, line.clear().append("P = start/pause emulator, O = stats"));
+        cpuInfoPanel.setLine(26, line.clear().append("Left/Right = forward/backward 1 CPU cycle"));
+
+        cpuInfoPanel.draw(texture);
     }
 
-    void draw()
+    TextPanel memoryPanel{c8::mem::listingLineCount};
+
+    void renderMemory(sf::RenderTexture& texture, const c8::mem::Listing& listing)
     {
-        const bool showEmulatorInfo = c8::config::showEmulatorInfo;
+        for (int i = 0; i < c8::mem::listingLineCount; i++) {
+            memoryPanel.setLine(i, listing[i]);
+        }
 
-        window->clear(sf::Color::Black);
+        memoryPanel.draw(texture);
+    }
+
+    void renderVga(sf::RenderTexture& texture, const c8::vga::VgaState& vgaState)
+    {
+        const sf::Color pixelColor{c8::config::pixelColor};
+
+        // Two triangles per lit pixel, the array keeps its capacity so this
+        // only allocates when more pixels are lit than ever before
+        vgaPixels.clear();
+
+        for (std::uint8_t y = 0; y < c8::vga::frameBufferHeight; y++) {
+            for (std::uint8_t x = 0; x < c8::vga::frameBufferWidth; x++) {
+                const bool bit = vgaState.getPixel(x, y);
+
+                if (!bit) {
+                    continue;
+                }
+
+                const auto left = static_cast<float>(x * c8::config::pixelWidth);
+                const auto top = static_cast<float>(y * c8::config::pixelHeight);
+                const auto right = left + c8::config::pixelWidth;
+                const auto bottom = top + c8::config::pixelHeight;
+
+                vgaPixels.append({{left, top}, pixelColor, {}});
+                vgaPixels.append({{right, top}, pixelColor, {}});
+                vgaPixels.append({{left, bottom}, pixelColor, {}});
+                vgaPixels.append({{left, bottom}, pixelColor, {}});
+                vgaPixels.append({{right, top}, pixelColor, {}});
+                vgaPixels.append({{right, bottom}, pixelColor, {}});
+            }
+        }
 
-        sf::RenderTexture vgaTexture;
-        sf::RenderTexture cpuInfoTexture;
-        sf::RenderTexture memoryTexture;
+        texture.draw(vgaPixels);
+    }
 
-        bool success = true;
+    TextPanel statsOverlay{statsOverlayLineCount};
 
-        success = success && vgaTexture.resize({c8::config::getRenderWidth(), c8::config::getRenderHeight()});
-        success = success && cpuInfoTexture.resize({500, 500});
-        success = success && memoryTexture.resize({500, 500});
+    void drawStatsOverlay(
+        sf::RenderTexture& texture,
+        const c8::cpu::Snapshot& snapshot,
+        const c8::phases::Summary& phaseSummary)
+    {
+        c8::format::Line line;
+
+        statsOverlay.setLine(0, line.clear().append("Backlog = ").appendDec(snapshot.backlogCycles).append(" cycles"));
+        statsOverlay.setLine(1, line.clear().append("Caught up = ").appendDec(snapshot.caughtUpCycles).append(" cycles"));
+        statsOverlay.setLine(2, line.clear().append("Dropped = ").appendDec(snapshot.droppedCycles).append(" cycles"));
+        statsOverlay.setLine(3, line.clear().append("Skipped frames = ").appendDec(snapshot.skippedFrames));
+
+        for (int i = 0; i < c8::phases::phaseCount; i++) {
+            const c8::phases::Percentiles& percentiles = phaseSummary[i];
+
+            const auto p50 = std::chrono::duration_cast<std::chrono::microseconds>(percentiles.p50);
+            const auto p99 = std::chrono::duration_cast<std::chrono::microseconds>(percentiles.p99);
+
+            line.clear()
+                .append(c8::phases::getPhaseName(static_cast<c8::phases::Phase>(i)))
+                .append(" = ").appendDec(p50.count())
+                .append(" / ").appendDec(p99.count()).append(" us");
+
+            statsOverlay.setLine(statsPacingLineCount + i, line);
+        }
+
+        if constexpr (c8::allocations::tracking) {
+            const c8::allocations::Counts& emulation = snapshot.emulationFrameAllocations;
+
+            line.clear()
+                .append("Emulation allocs = ").appendDec(emulation.allocations)
+                .append(" / frame, ").appendDec(emulation.bytes).append(" bytes");
+
+            statsOverlay.setLine(statsAllocationsFirstLine, line);
+
+            line.clear()
+                .append("Execute allocs = ").appendDec(snapshot.executeAllocations.allocations)
+                .append(" in ").appendDec(snapshot.executedCycles).append(" cycles");
+
+            statsOverlay.setLine(statsAllocationsFirstLine + 1, line);
+
+            line.clear()
+                .append("Render allocs = ").appendDec(renderFrameAllocations.allocations)
+                .append(" / frame, ").appendDec(renderFrameAllocations.bytes).append(" bytes");
+
+            statsOverlay.setLine(statsAllocationsFirstLine + 2, line);
+        }
+
+        int lineCount = statsPerfFirstLine;
+
+        for (int i = 0; i < c8::perf::counterCount; i++) {
+            const auto counter = static_cast<c8::perf::Counter>(i);
+
+            line.clear();
+
+            if (snapshot.hostCounters.has(counter) && snapshot.hostCountersCycles > 0) {
+                const auto hundredths = snapshot.hostCounters.get(counter) * 100 / snapshot.hostCountersCycles;
+
+                line.append("Host ").append(c8::perf::getCounterName(counter)).append(" / instr = ");
+                appendHundredths(line, static_cast<long long>(hundredths));
+
+                lineCount = statsPerfFirstLine + i + 1;
+            }
+
+            statsOverlay.setLine(statsPerfFirstLine + i, line);
+        }
+
+        statsOverlayBackground.setSize({
+            static_cast<float>(emulatorInfoWidth),
+            lineCount * lineSpacing + characterSize / 2
+        });
+
+        texture.draw(statsOverlayBackground);
+        statsOverlay.draw(texture);
+    }
+
+    // Writes are red, reads green and instruction fetches blue
+    void drawHeatmap(sf::RenderTexture& texture, const c8::mem::Heatmap& heatmap)
+    {
+        for (int addr = 0; addr < c8::mem::maxBufferSize; addr++) {
+            const c8::mem::HeatmapCell& cell = heatmap[addr];
+
+            const sf::Color color{cell.writes, cell.reads, cell.fetches};
+
+            sf::Vertex* vertices = &heatmapCells[addr * 6];
+
+            for (int i = 0; i < 6; i++) {
+                vertices[i].color = color;
+            }
+        }
+
+        texture.draw(heatmapCells);
+    }
 
-        vgaTexture.clear(c8::config::backgroundColor);
+    void draw(const c8::cpu::Snapshot& snapshot, c8::phases::Recorder& phases)
+    {
+        using c8::phases::Phase;
+
+        const bool showEmulatorInfo = c8::config::showEmulatorInfo;
+
+        auto phase = std::optional<c8::phases::Recorder::Scope>{std::in_place, phases, Phase::DrawSetup};
+
+        window->clear(sf::Color::Black);
+
+        vgaTexture.clear(sf::Color{c8::config::backgroundColor});
         cpuInfoTexture.clear(sf::Color::Black);
         memoryTexture.clear(sf::Color::Black);
 
-        c8::cpu::renderVga(vgaTexture);
+        phase.emplace(phases, Phase::DrawVga);
+
+        renderVga(vgaTexture, snapshot.vgaState);
+
+        if (showStatsOverlay) {
+            phase.emplace(phases, Phase::DrawOverlay);
+
+            // The emulation thread phases come with the snapshot, the render
+            // thread phases are this thread's own
+            c8::phases::Summary phaseSummary = snapshot.emulationPhases;
+
+            phases.fillSummary(phaseSummary);
+
+            drawStatsOverlay(vgaTexture, snapshot, phaseSummary);
+        }
+
+        if (showHeatmap && snapshot.heatmapEnabled) {
+            phase.emplace(phases, Phase::DrawOverlay);
+
+            drawHeatmap(vgaTexture, snapshot.heatmap);
+        }
 
         if (showEmulatorInfo) {
-            c8::cpu::renderCpuInfo(cpuInfoTexture);
-            c8::mem::render(memoryTexture);
+            phase.emplace(phases, Phase::DrawCpuInfo);
+
+            renderCpuInfo(cpuInfoTexture, snapshot);
+
+            phase.emplace(phases, Phase::DrawMemory);
+
+            renderMemory(memoryTexture, snapshot.memoryListing);
+
+            listingPc = snapshot.pc;
         }
 
+        phase.emplace(phases, Phase::Present);
+
         vgaTexture.display();
         cpuInfoTexture.display();
         memoryTexture.display();
@@ -137,8 +579,8 @@ namespace c8::ui
         sf::Sprite memorySprite{memoryTexture.getTexture()};
 
         vgaSprite.setPosition({0, 0});
-        cpuInfoSprite.setPosition({500, static_cast<float>(c8::config::getRenderHeight() + 10)});
-        memorySprite.setPosition({0, static_cast<float>(c8::config::getRenderHeight() + 10)});
+        cpuInfoSprite.setPosition({500, getInfoPanelTop()});
+        memorySprite.setPosition({0, getInfoPanelTop()});
 
         window->draw(vgaSprite);
 
@@ -150,54 +592,90 @@ namespace c8::ui
         window->display();
     }
 
-    void drawText(
-        sf::RenderTexture& texture, 
-        const int x, 
-        const int y, 
-        std::string str)
+    TextPanel::TextPanel(const std::size_t lineCount)
+        : lines(lineCount)
     {
-        sf::Text text{font};
-
-        text.setString(str);
-        text.setCharacterSize(18);
-        text.setFillColor(sf::Color::Green);
-        text.setPosition({static_cast<float>(x), static_cast<float>(y)});
-
-        texture.draw(text);
     }
 
-    void drawText(
-        sf::RenderTexture& texture, 
-        const int x, 
-        const int y, 
-        const std::stringstream& ss)
+    void TextPanel::setLine(const std::size_t index, const c8::format::Line& text)
     {
-        drawText(texture, x, y, ss.str());
-    }
+        Line& line = lines[index];
 
-    bool isOpen()
-    {
-        return window != nullptr && window->isOpen();
-    }
+        if (line.text == text) {
+            return;
+        }
 
-    Hex::Hex(std::uint8_t value, bool includeDec)
-        : value{value}, hexDigits{2}, decDigits{3}, includeDec{includeDec}
-    {
+        line.text = text;
+        line.dirty = true;
     }
 
-    Hex::Hex(std::uint16_t value, bool includeDec)
-        : value{value}, hexDigits{4}, decDigits{6}, includeDec{includeDec}
+    void TextPanel::layoutLine(const std::size_t index)
     {
+        Line& line = lines[index];
+
+        const float spaceAdvance = glyphAtlas[' '].advance;
+        const float baseline = static_cast<float>(index) * lineSpacing + characterSize;
+
+        float x = 0;
+
+        line.vertices.clear();
+
+        for (const char c : line.text.view()) {
+            if (c == '\t') {
+                x += spaceAdvance * tabWidth;
+                continue;
+            }
+
+            if (c <= ' ' || c > '~') {
+                x += spaceAdvance;
+                continue;
+            }
+
+            const sf::Glyph& glyph = glyphAtlas[c];
+
+            const float left = x + glyph.bounds.position.x;
+            const float top = baseline + glyph.bounds.position.y;
+            const float right = left + glyph.bounds.size.x;
+            const float bottom = top + glyph.bounds.size.y;
+
+            const auto u1 = static_cast<float>(glyph.textureRect.position.x);
+            const auto v1 = static_cast<float>(glyph.textureRect.position.y);
+            const auto u2 = u1 + static_cast<float>(glyph.textureRect.size.x);
+            const auto v2 = v1 + static_cast<float>(glyph.textureRect.size.y);
+
+            line.vertices.append({{left, top}, sf::Color::Green, {u1, v1}});
+            line.vertices.append({{right, top}, sf::Color::Green, {u2, v1}});
+            line.vertices.append({{left, bottom}, sf::Color::Green, {u1, v2}});
+            line.vertices.append({{left, bottom}, sf::Color::Green, {u1, v2}});
+            line.vertices.append({{right, top}, sf::Color::Green, {u2, v1}});
+            line.vertices.append({{right, bottom}, sf::Color::Green, {u2, v2}});
+
+            x += glyph.advance;
+        }
+
+        line.dirty = false;
     }
 
-    std::ostream& operator<<(std::ostream& ss, const Hex& hex)
+    void TextPanel::draw(sf::RenderTexture& texture)
     {
-        ss << "0x" << std::setfill('0') << std::setw(hex.hexDigits) << std::uppercase << std::hex << hex.value;
+        if (glyphAtlasTexture == nullptr) {
+            return;
+        }
+
+        sf::RenderStates states;
+        states.texture = glyphAtlasTexture;
 
-        if (hex.includeDec) {
-            ss << " (" << std::setfill('0') << std::setw(hex.decDigits) << std::dec << hex.value << ")";
+        for (std::size_t i = 0; i < lines.size(); i++) {
+            if (lines[i].dirty) {
+                layoutLine(i);
+            }
+
+            texture.draw(lines[i].vertices, states);
         }
+    }
 
-        return ss;
+    bool isOpen()
+    {
+        return window != nullptr && window->isOpen();
     }
 }
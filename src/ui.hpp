@@ -16,11 +16,16 @@
 #pragma once
 
 #include <unordered_map>
-#include <sstream>
 #include <string>
+#include <vector>
 
 #include <SFML/Graphics.hpp>
 
+#include "format.hpp"
+#include "allocations.hpp"
+#include "cpu.hpp"
+#include "phases.hpp"
+
 namespace c8::ui
 {
     inline const std::unordered_map<sf::Keyboard::Key, std::uint8_t> valueByKey = {
@@ -44,41 +49,51 @@ namespace c8::ui
 
     void initialize();
 
-    bool isOpen();
+    void setVerticalSyncEnabled(const bool enabled);
 
-    void pollInput();
+    void setFps(const int fps);
 
-    void draw();
+    /**
+     * Allocations the render thread made in its last frame, for the overlay
+    */
+    void setRenderAllocations(const c8::allocations::Counts& counts);
 
     bool isOpen();
 
-    void drawText(
-        sf::RenderTexture& texture, 
-        const int x, 
-        const int y, 
-        const std::stringstream& ss
-    );
-
-    void drawText(
-        sf::RenderTexture& texture, 
-        const int x, 
-        const int y, 
-        std::string text
-    );
-
-    class Hex
+    /**
+     * Translates window events into commands for the emulation thread
+    */
+    void pollInput(c8::cpu::CommandQueue& commands);
+
+    /**
+     * Draws one frame, timing each panel into the render thread's phases
+    */
+    void draw(const c8::cpu::Snapshot& snapshot, c8::phases::Recorder& phases);
+
+    /**
+     * A block of text lines laid out with the glyph atlas built from the
+     * embedded Courier font. Each line keeps its own vertex array, which is
+     * only rebuilt when the text of that line changes.
+    */
+    class TextPanel
     {
     private:
-        const int value;
-        const int hexDigits;
-        const int decDigits;
+        struct Line
+        {
+            c8::format::Line text;
+            sf::VertexArray vertices{sf::PrimitiveType::Triangles};
+            bool dirty = true;
+        };
+
+        std::vector<Line> lines;
+
+        void layoutLine(const std::size_t index);
 
-        const bool includeDec;
     public:
-        Hex(std::uint8_t value, bool includeDec = true);
+        explicit TextPanel(const std::size_t lineCount);
 
-        Hex(std::uint16_t value, bool includeDec = true);
+        void setLine(const std::size_t index, const c8::format::Line& text);
 
-        friend std::ostream& operator<<(std::ostream& ss, const Hex& hex);
+        void draw(sf::RenderTexture& texture);
     };
 }
\ No newline at end of file
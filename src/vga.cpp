@@ -14,17 +14,16 @@
 */
 
 #include "vga.hpp"
-#include "config.hpp"
+
+#include <bit>
+
+#include "quirks.hpp"
 
 namespace c8::vga
 {
     void VgaState::clear()
     {
-        for (std::uint8_t y = 0; y < frameBufferHeight; y++) {
-            for (std::uint8_t x = 0; x < frameBufferWidth; x++) {
-                frameBuffer[y][x] = false;
-            }
-        }
+        frameBuffer.fill(0);
     }
 
     bool VgaState::drawByte(
@@ -40,69 +39,44 @@ namespace c8::vga
             y = 0;
         }
 
-        bool didErase = false;
-
-        const bool originalBits[8] = {
-            frameBuffer[y][x + 0],
-            frameBuffer[y][x + 1],
-            frameBuffer[y][x + 2],
-            frameBuffer[y][x + 3],
-            frameBuffer[y][x + 4],
-            frameBuffer[y][x + 5],
-            frameBuffer[y][x + 6],
-            frameBuffer[y][x + 7],
-        };
-
-        frameBuffer[y][x + 0] ^= ((byte & 0b1000'0000) > 0);
-        frameBuffer[y][x + 1] ^= ((byte & 0b0100'0000) > 0);
-        frameBuffer[y][x + 2] ^= ((byte & 0b0010'0000) > 0);
-        frameBuffer[y][x + 3] ^= ((byte & 0b0001'0000) > 0);
-        frameBuffer[y][x + 4] ^= ((byte & 0b0000'1000) > 0);
-        frameBuffer[y][x + 5] ^= ((byte & 0b0000'0100) > 0);
-        frameBuffer[y][x + 6] ^= ((byte & 0b0000'0010) > 0);
-        frameBuffer[y][x + 7] ^= ((byte & 0b0000'0001) > 0);
-
-        const bool newBits[8] = {
-            frameBuffer[y][x + 0],
-            frameBuffer[y][x + 1],
-            frameBuffer[y][x + 2],
-            frameBuffer[y][x + 3],
-            frameBuffer[y][x + 4],
-            frameBuffer[y][x + 5],
-            frameBuffer[y][x + 6],
-            frameBuffer[y][x + 7],
-        };
-
-        for (int i = 0; i < 8; i++) {
-            const bool originalBit = originalBits[i];
-            const bool newBit = newBits[i];
-
-            if (originalBit && !newBit) {
-                didErase = true;
-            }
-        }
+        const std::uint64_t sprite = static_cast<std::uint64_t>(byte) << (frameBufferWidth - 8);
+
+        // The COSMAC VIP clips at the right edge, some later interpreters
+        // wrap around to the left edge of the same row
+        const std::uint64_t bits = c8::quirks::wrapSprites ? std::rotr(sprite, x) : sprite >> x;
+
+        const bool didErase = (frameBuffer[y] & bits) != 0;
+
+        frameBuffer[y] ^= bits;
 
         return didErase;
     }
 
-    void VgaState::render(sf::RenderTexture& texture) const
+    bool VgaState::getPixel(const std::uint8_t x, const std::uint8_t y) const
     {
-        for (std::uint8_t y = 0; y < frameBufferHeight; y++) {
-            for (std::uint8_t x = 0; x < frameBufferWidth; x++) {
-                const bool bit = frameBuffer[y][x];
+        if (x >= frameBufferWidth || y >= frameBufferHeight) {
+            return false;
+        }
 
-                const auto hostX = static_cast<float>(x * c8::config::pixelWidth);
-                const auto hostY = static_cast<float>(y * c8::config::pixelHeight);
+        return (frameBuffer[y] >> (frameBufferWidth - 1 - x)) & 1;
+    }
 
-                if (bit) {
-                    sf::RectangleShape rec{sf::Vector2f{c8::config::pixelWidth, c8::config::pixelHeight}};
+    const std::uint64_t* VgaState::getRows() const
+    {
+        return frameBuffer.data();
+    }
 
-                    rec.setFillColor(c8::config::pixelColor);
-                    rec.setPosition(sf::Vector2f{hostX, hostY});
+    std::uint64_t VgaState::hash() const
+    {
+        std::uint64_t hash = 0xCBF29CE484222325;
 
-                    texture.draw(rec);
-                }
+        for (std::uint8_t y = 0; y < frameBufferHeight; y++) {
+            for (std::uint8_t x = 0; x < frameBufferWidth; x++) {
+                hash ^= getPixel(x, y) ? 1 : 0;
+                hash *= 0x100000001B3;
             }
         }
+
+        return hash;
     }
-}
\ No newline at end of file
+}
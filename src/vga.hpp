@@ -16,8 +16,7 @@
 #pragma once
 
 #include <cstdint>
-
-#include <SFML/Graphics.hpp>
+#include <array>
 
 namespace c8::vga
 {
@@ -27,13 +26,30 @@ namespace c8::vga
     class VgaState
     {
     private:
-        bool frameBuffer[frameBufferHeight][frameBufferWidth];
+        // One bit per pixel, the most significant bit of a row is x = 0
+        std::array<std::uint64_t, frameBufferHeight> frameBuffer{};
 
     public:
+        /**
+         * XORs byte onto the row y starting at x, bits past the right edge
+         * are clipped, or wrapped with quirks::wrapSprites. Returns true if
+         * any pixel was turned off.
+        */
         bool drawByte(std::uint8_t x, std::uint8_t y, const std::uint8_t byte);
 
         void clear();
 
-        void render(sf::RenderTexture& texture) const;
+        bool getPixel(const std::uint8_t x, const std::uint8_t y) const;
+
+        /**
+         * The frameBufferHeight rows, one bit per pixel with x = 0 in the
+         * most significant bit
+        */
+        const std::uint64_t* getRows() const;
+
+        /**
+         * FNV-1a hash of the frame buffer, for comparing runs
+        */
+        std::uint64_t hash() const;
     };
 }